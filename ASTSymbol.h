@@ -1,13 +1,41 @@
 #pragma once
 
-#include <string>
+#include <string_view>
+#include <cctype>
 #include <cstddef>
 
+// One call site. The views point into the scanned source and are only valid
+// while that buffer is alive; callers copy what ends up in a Detection.
 struct AstSymbol {
-    std::string filePath;
-    std::size_t line;
-    std::string lang;
-    std::string callee_full;
-    std::string callee_base;
-    std::string first_arg;
+    // Arguments past these counts are not kept; rules on them cannot be evaluated.
+    static constexpr std::size_t kMaxArgs = 6;
+    static constexpr std::size_t kMaxKeywords = 4;
+
+    std::size_t      line;
+    const char*      lang;
+    std::string_view callee_full;
+    std::string_view callee_base;
+    std::string_view first_arg;
+    // For arg_index / kw rules (see ast_arg_value): positional arguments in order,
+    // and keyword arguments (Python name=value) by name.
+    std::string_view args[kMaxArgs];
+    std::string_view kw_names[kMaxKeywords];
+    std::string_view kw_values[kMaxKeywords];
+    unsigned char    arg_count = 0;
+    unsigned char    kw_count  = 0;
 };
+
+// An argument as rules see it: the body of a string or char literal (up to three
+// prefix letters such as b, r, u8; escapes are left as they are), otherwise the
+// whole expression.
+inline std::string_view ast_arg_value(std::string_view t){
+    std::size_t i = 0;
+    while(i<t.size() && i<3 && std::isalpha((unsigned char)t[i])) ++i;
+    if(i<t.size() && (t[i]=='"' || t[i]=='\'')){
+        const char q = t[i++];
+        const std::size_t b = i;
+        while(i<t.size() && t[i]!=q) i += (t[i]=='\\') ? 2 : 1;
+        return t.substr(b, (i<t.size() ? i : t.size()) - b);
+    }
+    return t;
+}
@@ -0,0 +1,83 @@
+#include "AhoCorasick.h"
+#include "BinaryIO.h"
+
+#include <cctype>
+
+void AhoCorasick::add(const unsigned char* needle, std::size_t n, std::uint32_t id){
+    if(n==0) return;
+    if(next.empty()){
+        next.assign(256, 0);
+        outs.emplace_back();
+    }
+    std::uint32_t st = 0;
+    for(std::size_t i=0; i<n; ++i){
+        const unsigned char c = icase ? (unsigned char)std::tolower(needle[i]) : needle[i];
+        std::uint32_t& slot = next[(std::size_t)st*256 + c];
+        if(slot==0){
+            slot = (std::uint32_t)outs.size();
+            outs.emplace_back();
+            next.resize(next.size()+256, 0);
+        }
+        st = next[(std::size_t)st*256 + c];
+    }
+    outs[st].push_back(id);
+    ++numNeedles;
+}
+
+void AhoCorasick::build(){
+    if(empty()) return;
+    const std::size_t states = outs.size();
+    std::vector<std::uint32_t> fail(states, 0);
+    std::vector<std::uint32_t> queue;
+    queue.reserve(states);
+
+    for(int c=0; c<256; ++c){
+        const std::uint32_t s = next[(std::size_t)c];
+        if(s){ fail[s] = 0; queue.push_back(s); }
+    }
+    for(std::size_t qi=0; qi<queue.size(); ++qi){
+        const std::uint32_t r = queue[qi];
+        const auto& inherited = outs[fail[r]];
+        outs[r].insert(outs[r].end(), inherited.begin(), inherited.end());
+        for(int c=0; c<256; ++c){
+            std::uint32_t& slot = next[(std::size_t)r*256 + c];
+            const std::uint32_t viaFail = next[(std::size_t)fail[r]*256 + c];
+            if(slot){
+                fail[slot] = viaFail;
+                queue.push_back(slot);
+            }else{
+                slot = viaFail;
+            }
+        }
+    }
+    if(icase){
+        for(std::size_t s=0; s<states; ++s){
+            for(int c='A'; c<='Z'; ++c) next[s*256 + c] = next[s*256 + (c - 'A' + 'a')];
+        }
+    }
+
+    outBegin.assign(states+1, 0);
+    outIds.clear();
+    for(std::size_t s=0; s<states; ++s){
+        outBegin[s] = (std::uint32_t)outIds.size();
+        outIds.insert(outIds.end(), outs[s].begin(), outs[s].end());
+    }
+    outBegin[states] = (std::uint32_t)outIds.size();
+    outs.clear();
+    outs.shrink_to_fit();
+}
+
+void AhoCorasick::save(std::string& out) const {
+    binio::putU32(out, icase ? 1 : 0);
+    binio::putU64(out, numNeedles);
+    binio::putPod(out, next);
+    binio::putPod(out, outBegin);
+    binio::putPod(out, outIds);
+}
+
+bool AhoCorasick::load(binio::Reader& r){
+    icase = r.u32() != 0;
+    numNeedles = (std::size_t)r.u64();
+    outs.clear();
+    return r.pod(next) && r.pod(outBegin) && r.pod(outIds);
+}
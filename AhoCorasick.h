@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace binio { struct Reader; }
+
+// Dense Aho-Corasick automaton: every needle is found in one pass over the input.
+class AhoCorasick {
+public:
+    explicit AhoCorasick(bool caseInsensitive = false) : icase(caseInsensitive) {}
+
+    void add(const unsigned char* needle, std::size_t n, std::uint32_t id);
+    void add(const std::string& needle, std::uint32_t id){
+        add(reinterpret_cast<const unsigned char*>(needle.data()), needle.size(), id);
+    }
+    void build();
+
+    bool empty() const { return numNeedles==0; }
+
+    // Built automaton only (after build()).
+    void save(std::string& out) const;
+    bool load(binio::Reader& r);
+
+    // Calls onMatch(id, end) for every occurrence of every needle, end being one past its last byte.
+    template<class F>
+    void scan(const unsigned char* data, std::size_t n, F&& onMatch) const {
+        std::uint32_t st = 0;
+        scan(data, n, st, std::forward<F>(onMatch));
+    }
+
+    // True as soon as one needle occurs.
+    bool any(const unsigned char* data, std::size_t n) const {
+        if(empty()) return false;
+        std::uint32_t st = 0;
+        for(std::size_t i=0; i<n; ++i){
+            st = next[(std::size_t)st*256 + data[i]];
+            if(outBegin[st] != outBegin[st+1]) return true;
+        }
+        return false;
+    }
+
+    // Resumable form: state starts at 0 and carries matches across consecutive buffers.
+    // end is relative to data.
+    template<class F>
+    void scan(const unsigned char* data, std::size_t n, std::uint32_t& state, F&& onMatch) const {
+        if(empty()) return;
+        std::uint32_t st = state;
+        for(std::size_t i=0; i<n; ++i){
+            st = next[(std::size_t)st*256 + data[i]];
+            const std::uint32_t b = outBegin[st], e = outBegin[st+1];
+            for(std::uint32_t k=b; k<e; ++k) onMatch(outIds[k], i+1);
+        }
+        state = st;
+    }
+
+private:
+    bool icase;
+    std::size_t numNeedles = 0;
+    std::vector<std::uint32_t> next;
+    std::vector<std::vector<std::uint32_t>> outs;
+    std::vector<std::uint32_t> outBegin;
+    std::vector<std::uint32_t> outIds;
+};
@@ -0,0 +1,128 @@
+#include "AstRuleIndex.h"
+
+#include <cstring>
+
+namespace analyzers {
+
+namespace {
+
+// std::regex has no inline flags; a leading (?i) becomes the icase option.
+std::optional<std::regex> compileArgRegex(std::string pat, std::string* why = nullptr){
+    auto flags = std::regex_constants::ECMAScript;
+    if(pat.rfind("(?i)", 0) == 0){
+        pat.erase(0, 4);
+        flags |= std::regex_constants::icase;
+    }
+    try{
+        return std::regex(pat, flags);
+    }catch(const std::exception& e){
+        if(why) *why = e.what();
+    }catch(...){
+        if(why) *why = "unknown regex compile error";
+    }
+    return std::nullopt;
+}
+
+bool search(std::string_view s, const std::regex& rx, std::string& match){
+    std::cmatch m;
+    if(s.empty() || !std::regex_search(s.data(), s.data() + s.size(), m, rx)) return false;
+    match = m.str(0);
+    return true;
+}
+
+}
+
+bool AstRuleIndex::usable(const pattern_loader::AstRule& r, std::string& why){
+    if(r.callee.empty() && r.callees.empty()){ why = "no callee"; return false; }
+    if(r.arg_index >= (int)AstSymbol::kMaxArgs){
+        why = "arg_index " + std::to_string(r.arg_index) + " is past the " + std::to_string(AstSymbol::kMaxArgs)
+            + " arguments kept per call";
+        return false;
+    }
+    std::string err;
+    if(!r.arg_regex.empty() && !compileArgRegex(r.arg_regex, &err)){ why = "arg_regex: " + err; return false; }
+    if(!r.kw_value_regex.empty() && !compileArgRegex(r.kw_value_regex, &err)){ why = "kw_value_regex: " + err; return false; }
+    return true;
+}
+
+AstRuleIndex::AstRuleIndex(const std::vector<pattern_loader::AstRule>& src){
+    for(const auto& r: src){
+        std::string why;
+        if(!usable(r, why)){ ++skipped; continue; }
+
+        Rule rule;
+        rule.algorithm    = r.message.empty() ? r.id : r.message;
+        rule.severity     = r.severity.empty() ? std::string("med") : r.severity;
+        rule.fullNameOnly = r.kind.rfind("call_fullname", 0) == 0;
+        rule.argIndex     = r.arg_index;
+        if(!r.arg_regex.empty()) rule.argRegex = compileArgRegex(r.arg_regex);
+        rule.kw = r.kw;
+        if(!r.kw_value_regex.empty()) rule.kwRegex = compileArgRegex(r.kw_value_regex);
+
+        const std::size_t idx = rules.size();
+        rules.push_back(std::move(rule));
+        if(!r.callee.empty()) add(r.lang, r.callee, idx);
+        for(const auto& c: r.callees) add(r.lang, c, idx);
+    }
+}
+
+void AstRuleIndex::add(const std::string& lang, const std::string& callee, std::size_t idx){
+    auto it = byLang.begin();
+    while(it != byLang.end() && it->first != lang) ++it;
+    if(it == byLang.end()) it = byLang.insert(byLang.end(), { lang, {} });
+    const std::string& name = *names.insert(callee).first;
+    it->second[name].push_back(idx);
+}
+
+// match is the text the first regex matched, or name=value of a required keyword;
+// it stays empty for rules on the callee alone.
+bool AstRuleIndex::evaluate(const Rule& r, const AstSymbol& s, std::size_t maxArg, std::string& match){
+    if(r.argIndex > 0 || r.argRegex){
+        std::string_view arg;
+        if(r.argIndex <= 0) arg = s.first_arg;
+        else if((std::size_t)r.argIndex < s.arg_count) arg = s.args[r.argIndex];
+        else return false;
+        if(r.argRegex && !search(arg.substr(0, maxArg), *r.argRegex, match)) return false;
+    }
+    if(r.kw.empty() && !r.kwRegex) return true;
+    for(std::size_t k=0; k<s.kw_count; ++k){
+        if(!r.kw.empty() && s.kw_names[k] != r.kw) continue;
+        std::string kwMatch;
+        if(r.kwRegex && !search(s.kw_values[k].substr(0, maxArg), *r.kwRegex, kwMatch)) continue;
+        if(match.empty()) match = r.kwRegex ? kwMatch : std::string(s.kw_names[k]) + "=" + std::string(s.kw_values[k]);
+        return true;
+    }
+    return false;
+}
+
+void AstRuleIndex::lookup(const CalleeMap& callees, std::string_view name, bool isFull,
+                          const AstSymbol& s, std::size_t maxArg, std::vector<Hit>& out) const {
+    auto it = callees.find(name);
+    if(it == callees.end()) return;
+    for(std::size_t idx: it->second){
+        const Rule& r = rules[idx];
+        if(r.fullNameOnly && !isFull) continue;
+        std::string match;
+        if(!evaluate(r, s, maxArg, match)) continue;
+        out.push_back({ &r.algorithm, &r.severity, match.empty() ? std::string(s.callee_full) : std::move(match) });
+    }
+}
+
+void AstRuleIndex::match(const AstSymbol& s, std::vector<Hit>& out, std::size_t maxArg) const {
+    if(s.callee_full.empty()) return;
+    auto lang = byLang.begin();
+    while(lang != byLang.end() && std::strcmp(lang->first.c_str(), s.lang) != 0) ++lang;
+    if(lang == byLang.end()) return;
+    const std::string_view full = s.callee_full;
+    lookup(lang->second, full, true, s, maxArg, out);
+
+    // trailing components after '.', "::" or "->"
+    for(std::size_t i = full.size(); i-- > 0; ){
+        const char c = full[i];
+        if(c=='.' || (c==':' && i>0 && full[i-1]==':') || (c=='>' && i>0 && full[i-1]=='-')){
+            lookup(lang->second, full.substr(i + 1), false, s, maxArg, out);
+        }
+    }
+}
+
+} // namespace analyzers
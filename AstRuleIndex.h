@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ASTSymbol.h"
+#include "PatternLoader.h"
+
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+
+namespace analyzers {
+
+// AST rules compiled into a table keyed by (language, callee name). A call site
+// costs a few hash lookups; arg_regex and kw_value_regex only run for sites whose
+// callee is in the table. "call" rules also match on the callee's trailing
+// components (Crypto.Cipher.DES.new hits DES.new, ctx->MD5 hits MD5);
+// "call_fullname*" rules need the whole callee text. arg_regex applies to
+// argument arg_index (the first when unset); kw requires that keyword argument
+// and kw_value_regex its value (any keyword's value when kw is empty).
+class AstRuleIndex {
+public:
+    struct Hit {
+        const std::string* algorithm;
+        const std::string* severity;
+        std::string        match;
+    };
+
+    explicit AstRuleIndex(const std::vector<pattern_loader::AstRule>& rules);
+    AstRuleIndex(const AstRuleIndex&) = delete;
+    AstRuleIndex& operator=(const AstRuleIndex&) = delete;
+
+    // The regexes see at most maxArg bytes of an argument (std::regex recursion).
+    void match(const AstSymbol& s, std::vector<Hit>& out, std::size_t maxArg = std::string_view::npos) const;
+
+    // False, with the reason, for a rule the index cannot evaluate and drops.
+    static bool usable(const pattern_loader::AstRule& r, std::string& why);
+
+    std::size_t size() const { return rules.size(); }
+    std::size_t dropped() const { return skipped; }
+    const std::unordered_set<std::string>& callees() const { return names; }
+
+private:
+    struct Rule {
+        std::string algorithm;
+        std::string severity;
+        bool        fullNameOnly;
+        int         argIndex;
+        std::optional<std::regex> argRegex;
+        std::string kw;
+        std::optional<std::regex> kwRegex;
+    };
+
+    // Callee keys are views into names, so a lookup never builds a string.
+    using CalleeMap = std::unordered_map<std::string_view, std::vector<std::size_t>>;
+
+    std::vector<Rule> rules;
+    std::unordered_set<std::string> names;
+    std::vector<std::pair<std::string, CalleeMap>> byLang;
+    std::size_t skipped = 0;
+
+    void add(const std::string& lang, const std::string& callee, std::size_t idx);
+    void lookup(const CalleeMap& callees, std::string_view name, bool isFull,
+                const AstSymbol& s, std::size_t maxArg, std::vector<Hit>& out) const;
+    static bool evaluate(const Rule& r, const AstSymbol& s, std::size_t maxArg, std::string& match);
+};
+
+} // namespace analyzers
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Readers and writers for the scanner's own binary files (scan cache, compiled
+// pattern database). Values are stored in native byte order: both files are
+// caches that are simply rebuilt when they come from a different machine.
+namespace binio {
+
+inline void putU32(std::string& out, std::uint32_t v){ out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+inline void putU64(std::string& out, std::uint64_t v){ out.append(reinterpret_cast<const char*>(&v), sizeof v); }
+inline void putStr(std::string& out, const std::string& s){ putU32(out, (std::uint32_t)s.size()); out += s; }
+
+template<class T>
+void putPod(std::string& out, const std::vector<T>& v){
+    static_assert(std::is_trivially_copyable<T>::value, "putPod needs a trivially copyable type");
+    putU64(out, v.size());
+    out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+// Every read past the end clears ok and yields zero / empty values.
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    Reader(const void* data, std::size_t n)
+        : p(static_cast<const char*>(data)), end(static_cast<const char*>(data) + n) {}
+
+    bool take(void* dst, std::size_t n){
+        if(!ok || (std::size_t)(end - p) < n) return ok = false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    std::uint32_t u32(){ std::uint32_t v = 0; take(&v, sizeof v); return v; }
+    std::uint64_t u64(){ std::uint64_t v = 0; take(&v, sizeof v); return v; }
+    std::string str(){
+        const std::uint32_t n = u32();
+        if(!ok || (std::size_t)(end - p) < n){ ok = false; return {}; }
+        std::string s(p, n);
+        p += n;
+        return s;
+    }
+    template<class T>
+    bool pod(std::vector<T>& v){
+        static_assert(std::is_trivially_copyable<T>::value, "pod needs a trivially copyable type");
+        const std::uint64_t n = u64();
+        if(!ok || n > (std::uint64_t)(end - p) / sizeof(T)) return ok = false;
+        v.resize((std::size_t)n);
+        return take(v.data(), (std::size_t)n * sizeof(T));
+    }
+};
+
+} // namespace binio
@@ -0,0 +1,51 @@
+#include "ContentDedup.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+
+bool ContentDedup::hashFile(const std::string& path, std::uint64_t& hash){
+    MappedFile mf(path);
+    if(!mf.isOpen()) return false;
+    hash = content_hash::xxh64(mf.data(), mf.size());
+    return true;
+}
+
+std::vector<Detection> ContentDedup::reroot(const std::vector<Detection>& ds, const std::string& from, const std::string& to){
+    std::vector<Detection> out;
+    out.reserve(ds.size());
+    for(const auto& d: ds){
+        out.push_back(d);
+        if(d.filePath.compare(0, from.size(), from) == 0) out.back().filePath = to + d.filePath.substr(from.size());
+    }
+    return out;
+}
+
+ContentDedup::Claim ContentDedup::claim(const DirectoryWalker::Entry& e, std::uint64_t hash, int kind, std::size_t ticket,
+                                        std::vector<Detection>& out){
+    std::lock_guard<std::mutex> lk(m);
+    auto ins = groups.try_emplace(Key{ e.size, hash, kind });
+    Group& g = ins.first->second;
+    if(ins.second){
+        g.ownerPath = e.path;
+        return Claim::Owner;
+    }
+    if(!g.published){
+        g.waiters.push_back({ e, ticket, {} });
+        return Claim::Pending;
+    }
+    out = reroot(g.detections, g.ownerPath, e.path);
+    return Claim::Duplicate;
+}
+
+std::vector<ContentDedup::Waiter> ContentDedup::publish(const DirectoryWalker::Entry& owner, std::uint64_t hash, int kind,
+                                                        const std::vector<Detection>& detections){
+    std::vector<Waiter> waiters;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        Group& g = groups[Key{ owner.size, hash, kind }];
+        g.published = true;
+        g.detections = detections;
+        waiters.swap(g.waiters);
+    }
+    for(auto& w: waiters) w.detections = reroot(detections, owner.path, w.entry.path);
+    return waiters;
+}
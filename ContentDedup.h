@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CryptoScanner.h"
+#include "DirectoryWalker.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Content-addressed index of files seen during one scan. Files with the same
+// size, xxh64 and scan kind (CryptoScanner::scanKind: which scanner the extension
+// selects) are scanned once; every further copy gets the first copy's
+// detections re-rooted at its own path. Nothing ever blocks: a copy that shows
+// up while the first one is still being scanned is parked and handed back by
+// publish(). All members are thread-safe.
+class ContentDedup {
+public:
+    enum class Claim { Owner, Duplicate, Pending };
+
+    struct Waiter {
+        DirectoryWalker::Entry entry;
+        std::size_t            ticket;
+        std::vector<Detection> detections;
+    };
+
+    static bool hashFile(const std::string& path, std::uint64_t& hash);
+
+    // Owner: the caller must scan e and publish() the result.
+    // Duplicate: out holds the detections for e.
+    // Pending: e is parked under ticket until the owner publishes.
+    Claim claim(const DirectoryWalker::Entry& e, std::uint64_t hash, int kind, std::size_t ticket, std::vector<Detection>& out);
+
+    // Stores the owner's detections and returns the copies parked so far.
+    std::vector<Waiter> publish(const DirectoryWalker::Entry& owner, std::uint64_t hash, int kind,
+                                const std::vector<Detection>& detections);
+
+private:
+    struct Key {
+        std::uint64_t size, hash;
+        int           kind;
+        bool operator==(const Key& o) const { return size==o.size && hash==o.hash && kind==o.kind; }
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key& k) const { return (std::size_t)(k.hash ^ ((k.size + (std::uint64_t)k.kind) * 0x9E3779B97F4A7C15ull)); }
+    };
+    struct Group {
+        std::string            ownerPath;
+        bool                   published = false;
+        std::vector<Detection> detections;
+        std::vector<Waiter>    waiters;
+    };
+
+    static std::vector<Detection> reroot(const std::vector<Detection>& ds, const std::string& from, const std::string& to);
+
+    std::mutex m;
+    std::unordered_map<Key, Group, KeyHash> groups;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Fast non-cryptographic 64-bit hashing (XXH64) for cache keys and duplicate detection.
+namespace content_hash {
+
+std::uint64_t xxh64(const void* data, std::size_t n, std::uint64_t seed = 0);
+
+inline std::uint64_t xxh64(std::string_view s, std::uint64_t seed = 0){
+    return xxh64(s.data(), s.size(), seed);
+}
+
+// Order-dependent combination of two hashes.
+inline std::uint64_t combine(std::uint64_t h, std::uint64_t v){
+    return h ^ (v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+}
+
+} // namespace content_hash
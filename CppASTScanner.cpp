@@ -1,8 +1,8 @@
 #include "CppASTScanner.h"
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cctype>
 #include <cstring>
@@ -12,27 +12,21 @@ extern "C" const TSLanguage *tree_sitter_cpp();
 
 namespace {
 
-std::string read_file(const std::string& path){
-    std::ifstream in(path, std::ios::binary);
-    std::ostringstream ss; ss<<in.rdbuf();
-    return ss.str();
-}
-
-std::string trim(const std::string& s){
+std::string_view trim(std::string_view s){
     size_t i=0,j=s.size();
     while(i<j && std::isspace((unsigned char)s[i]))++i;
     while(j>i && std::isspace((unsigned char)s[j-1]))--j;
     return s.substr(i,j-i);
 }
 
-std::string node_text(TSNode n, const std::string& src){
+std::string_view node_view(TSNode n, std::string_view src){
     uint32_t a=ts_node_start_byte(n), b=ts_node_end_byte(n);
     if(b>src.size()) b=(uint32_t)src.size();
     if(a>b) a=b;
-    return std::string(src.data()+a, src.data()+b);
+    return src.substr(a, b-a);
 }
 
-std::string base_name_of(const std::string& s){
+std::string_view base_name_of(std::string_view s){
     if(s.empty()) return {};
     size_t i=s.size();
     while(i>0 && !std::isalnum((unsigned char)s[i-1]) && s[i-1]!='_') --i;
@@ -41,80 +35,111 @@ std::string base_name_of(const std::string& s){
     return s.substr(i, e-i);
 }
 
+// First argument: the body of a string or char literal (escapes are left as
+// they are), otherwise the whole argument expression.
+std::string_view first_arg_view(TSNode args, std::string_view src){
+    if(ts_node_is_null(args)) return {};
+    const uint32_t nc = ts_node_named_child_count(args);
+    for(uint32_t k=0; k<nc; ++k){
+        TSNode a0 = ts_node_named_child(args, k);
+        if(ts_node_is_null(a0) || ts_node_is_extra(a0)) continue;
+        std::string_view t = trim(node_view(a0, src));
+        if(t.size()>=2 && (t.front()=='"' || t.front()=='\'')){
+            const char q=t.front();
+            size_t i=1;
+            while(i<t.size() && t[i]!=q) i += (t[i]=='\\') ? 2 : 1;
+            return t.substr(1, std::min(i, t.size()) - 1);
+        }
+        return t;
+    }
+    return {};
+}
+
+// Positional argument views for rules with arg_index.
+void collect_args(TSNode args, std::string_view src, AstSymbol& s){
+    if(ts_node_is_null(args)) return;
+    const uint32_t nc = ts_node_named_child_count(args);
+    for(uint32_t k=0; k<nc && s.arg_count<AstSymbol::kMaxArgs; ++k){
+        TSNode a = ts_node_named_child(args, k);
+        if(ts_node_is_null(a) || ts_node_is_extra(a)) continue;
+        s.args[s.arg_count++] = ast_arg_value(trim(node_view(a, src)));
+    }
+}
+
+// Parser reused by every file scanned on the same thread.
+struct ThreadParser {
+    TSParser* parser = ts_parser_new();
+    ThreadParser(){ ts_parser_set_language(parser, tree_sitter_cpp()); }
+    ~ThreadParser(){ ts_parser_delete(parser); }
+};
+
+// Symbol and field ids of call_expression, looked up once so the walk compares
+// ids instead of node type and field name strings.
+struct CallGrammar {
+    std::vector<bool> isCall;
+    TSFieldId function = 0, arguments = 0;
+};
+
+const CallGrammar& callGrammar(){
+    static const CallGrammar g = []{
+        CallGrammar cg;
+        const TSLanguage* lang = tree_sitter_cpp();
+        if(!lang) return cg;
+        cg.isCall.resize(ts_language_symbol_count(lang));
+        for(uint32_t i=0; i<cg.isCall.size(); ++i){
+            const char* name = ts_language_symbol_name(lang, (TSSymbol)i);
+            cg.isCall[i] = name && std::strcmp(name, "call_expression")==0;
+        }
+        cg.function  = ts_language_field_id_for_name(lang, "function", 8);
+        cg.arguments = ts_language_field_id_for_name(lang, "arguments", 9);
+        return cg;
+    }();
+    return g;
+}
+
 }
 
 namespace analyzers {
 
-std::vector<AstSymbol> CppASTScanner::collectSymbols(const std::string& path){
+std::vector<AstSymbol> CppASTScanner::collectSymbols(std::string_view code){
     std::vector<AstSymbol> out;
-    std::string code = read_file(path);
     if(code.empty()) return out;
 
-    TSParser* parser = ts_parser_new();
-    ts_parser_set_language(parser, tree_sitter_cpp());
-    TSTree* tree = ts_parser_parse_string(parser, nullptr, code.c_str(), (uint32_t)code.size());
-    if(!tree){ ts_parser_delete(parser); return out; }
+    const CallGrammar& grammar = callGrammar();
+    thread_local ThreadParser tp;
+    TSTree* tree = ts_parser_parse_string(tp.parser, nullptr, code.data(), (uint32_t)code.size());
+    if(!tree){ ts_parser_reset(tp.parser); return out; }
 
     TSNode root = ts_tree_root_node(tree);
     std::vector<TSNode> stack; stack.push_back(root);
 
     while(!stack.empty()){
         TSNode n = stack.back(); stack.pop_back();
-        const char* t = ts_node_type(n);
+        const TSSymbol sym = ts_node_symbol(n);
 
-        if(std::strcmp(t,"call_expression")==0){
-            TSNode fn = ts_node_child_by_field_name(n, "function", 8);
-            TSNode args = ts_node_child_by_field_name(n, "arguments", 9);
-            std::string callee_full, callee_base, first_arg;
+        if(sym < grammar.isCall.size() && grammar.isCall[sym]){
+            TSNode fn = ts_node_child_by_field_id(n, grammar.function);
+            TSNode args = ts_node_child_by_field_id(n, grammar.arguments);
+            std::string_view callee_full;
 
             if(!ts_node_is_null(fn)){
-                callee_full = trim(node_text(fn, code));
-                callee_base = base_name_of(callee_full);
+                callee_full = trim(node_view(fn, code));
             }else{
-                std::string seg = trim(node_text(n, code));
+                std::string_view seg = trim(node_view(n, code));
                 auto p = seg.find('(');
-                if(p!=std::string::npos) callee_full = trim(seg.substr(0,p));
-                callee_base = base_name_of(callee_full);
-            }
-
-            if(!ts_node_is_null(args)){
-                uint32_t nc = ts_node_named_child_count(args);
-                if(nc>0){
-                    TSNode a0 = ts_node_named_child(args, 0);
-                    if(!ts_node_is_null(a0)){
-                        std::string a0txt = trim(node_text(a0, code));
-                        if(!a0txt.empty()){
-                            if(a0txt.size()>=2 && (a0txt.front()=='"' || a0txt.front()=='\'')){
-                                char q=a0txt.front();
-                                size_t i=1;
-                                std::string v;
-                                while(i<a0txt.size()){
-                                    char c=a0txt[i++];
-                                    if(c=='\\' && i<a0txt.size()){ v.push_back(a0txt[i++]); continue; }
-                                    if(c==q) break;
-                                    v.push_back(c);
-                                }
-                                first_arg = v;
-                            }else{
-                                first_arg = a0txt;
-                            }
-                        }
-                    }
-                }
+                if(p!=std::string_view::npos) callee_full = trim(seg.substr(0,p));
             }
 
-            TSPoint p = ts_node_start_point(n);
-            size_t line = (size_t)p.row + 1;
-
             if(!callee_full.empty()){
+                const std::string_view callee_base = base_name_of(callee_full);
                 AstSymbol s;
-                s.filePath = path;
-                s.line = line;
+                s.line = (size_t)ts_node_start_point(n).row + 1;
                 s.lang = "cpp";
                 s.callee_full = callee_full;
                 s.callee_base = callee_base.empty()? callee_full : callee_base;
-                s.first_arg = first_arg;
-                out.push_back(std::move(s));
+                s.first_arg = first_arg_view(args, code);
+                collect_args(args, code, s);
+                out.push_back(s);
             }
         }
 
@@ -128,7 +153,6 @@ std::vector<AstSymbol> CppASTScanner::collectSymbols(const std::string& path){
     }
 
     ts_tree_delete(tree);
-    ts_parser_delete(parser);
     return out;
 }
 
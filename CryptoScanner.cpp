@@ -5,9 +5,19 @@
 #include "PythonASTScanner.h"
 #include "CppASTScanner.h"
 #include "ASTSymbol.h"
+#include "AstRuleIndex.h"
+#include "SourceGate.h"
+#include "RegexPrefilter.h"
+#include "RegexBudget.h"
+#include "WorkStealingPool.h"
+#include "DirectoryWalker.h"
+#include "ScanCache.h"
+#include "ContentDedup.h"
+#include "ContentHash.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cctype>
 #include <cstdio>
 #include <cstring>
@@ -15,9 +25,12 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -33,28 +46,51 @@ static inline bool ends_with(const std::string& s, const std::string& suffix){
     return std::equal(suffix.rbegin(), suffix.rend(), s.rbegin());
 }
 
-static std::string toLowerStr(const std::string& s){
+static std::string toLowerStr(std::string_view s){
     std::string o; o.reserve(s.size());
     for(unsigned char c: s) o.push_back((char)std::tolower(c));
     return o;
 }
 
-static bool pathStartsWith(const fs::path& p, const std::string& rootPrefix){
-    auto s = p.string();
+static bool pathStartsWith(const std::string& s, const std::string& rootPrefix){
     if(rootPrefix.empty()) return false;
     if(s.size() < rootPrefix.size()) return false;
     return std::equal(rootPrefix.begin(), rootPrefix.end(), s.begin());
 }
 
+// Paths a walk of root can produce (DirectoryWalker joins names with '/').
+static std::function<bool(const std::string&)> underRoot(const std::string& root, bool recurse = true){
+    const std::string prefix = (!root.empty() && root.back()=='/') ? root : root + "/";
+    return [prefix, recurse](const std::string& p){
+        return pathStartsWith(p, prefix) && (recurse || p.find('/', prefix.size()) == std::string::npos);
+    };
+}
+
+// strings come from extractAsciiStrings and are therefore sorted by offset and disjoint.
 static const AsciiString* findContextString(const std::vector<AsciiString>& strings, std::size_t matchOffset){
-    for(const auto& s: strings){
-        const std::size_t begin = s.offset;
-        const std::size_t end   = s.offset + s.text.size();
-        if(matchOffset >= begin && matchOffset < end) return &s;
-    }
+    auto it = std::upper_bound(strings.begin(), strings.end(), matchOffset,
+                               [](std::size_t off, const AsciiString& s){ return off < s.offset; });
+    if(it == strings.begin()) return nullptr;
+    --it;
+    if(matchOffset < it->offset + it->text.size()) return &*it;
     return nullptr;
 }
 
+// Lower-cased context string of a match; consecutive matches in the same string share one copy.
+struct ContextLowerCache {
+    const AsciiString* ctx = nullptr;
+    std::string lower;
+
+    const std::string& of(const std::vector<AsciiString>& strings, std::size_t matchOffset){
+        const AsciiString* c = findContextString(strings, matchOffset);
+        if(c != ctx){
+            ctx = c;
+            lower = c ? toLowerStr(c->text) : std::string();
+        }
+        return lower;
+    }
+};
+
 static bool isIsolatedNoiseToken(const std::string& algName, const std::string& matched, const std::string& contextLower){
     (void)algName; (void)matched; (void)contextLower;
     return false;
@@ -85,24 +121,47 @@ std::uintmax_t CryptoScanner::getFileSizeSafe(const std::string& path){
 }
 
 bool CryptoScanner::readTextFile(const std::string& path, std::string& out){
-    std::ifstream in(path, std::ios::binary);
-    if(!in) return false;
-    std::ostringstream ss; ss<<in.rdbuf();
-    out = ss.str();
+    MappedFile f;
+    if(!f.open(path)) return false;
+    out.assign(f.view());
     return true;
 }
 
 bool CryptoScanner::readAllBytes(const std::string& path, std::vector<unsigned char>& out){
-    std::ifstream in(path, std::ios::binary);
-    if(!in) return false;
-    in.seekg(0, std::ios::end);
-    std::streamoff n = in.tellg();
-    in.seekg(0, std::ios::beg);
-    out.resize((size_t)std::max<int64_t>(0, n));
-    in.read((char*)out.data(), (std::streamsize)out.size());
+    MappedFile f;
+    if(!f.open(path)) return false;
+    out.assign(f.data(), f.data() + f.size());
     return true;
 }
 
+bool CryptoScanner::isArchiveExt(const std::string& ext){
+    return ext==".jar" || ext==".zip" || ext==".war" || ext==".ear";
+}
+
+bool CryptoScanner::isScannableArchiveEntry(const std::string& name){
+    static const std::unordered_set<std::string> exts = {
+        ".class",".java",".properties",".xml",".mf",".sf",".rsa",".dsa",".ec",
+        ".so",".dll",".dylib",".jnilib"
+    };
+    const std::string ext = lowercaseExt(name);
+    if(exts.count(ext) || isCertOrKeyExt(ext) || isArchiveExt(ext)) return true;
+    // versioned shared objects: libfoo.so.1.2
+    const std::size_t base = name.find_last_of('/');
+    return name.find(".so.", base == std::string::npos ? 0 : base) != std::string::npos;
+}
+
+int CryptoScanner::scanKind(const std::string& ext){
+    enum { Other, Jar, Archive, Class, CertOrKey, Java, Python, Cpp };
+    if(ext==".jar") return Jar;
+    if(isArchiveExt(ext)) return Archive;
+    if(ext==".class") return Class;
+    if(isCertOrKeyExt(ext)) return CertOrKey;
+    if(ext==".java") return Java;
+    if(ext==".py") return Python;
+    if(ext==".c" || ext==".cc" || ext==".cpp" || ext==".cxx" || ext==".h" || ext==".hpp" || ext==".hh" || ext==".ld") return Cpp;
+    return Other;
+}
+
 bool CryptoScanner::isCertOrKeyExt(const std::string& ext){
     static const std::unordered_set<std::string> exts = {
         ".cer",".crt",".der",".pem",".key",".p7b",".p7c",".p12",".pfx",".csr"
@@ -110,27 +169,30 @@ bool CryptoScanner::isCertOrKeyExt(const std::string& ext){
     return exts.count(ext) != 0;
 }
 
-static bool isPemLine(const std::string& s){
-    return s.find("-----BEGIN ")!=std::string::npos || s.find("-----END ")!=std::string::npos;
+static constexpr std::size_t kPemSniffBytes = 4096;
+
+static bool isPemLine(std::string_view s){
+    return s.find("-----BEGIN ")!=std::string_view::npos || s.find("-----END ")!=std::string_view::npos;
 }
 
-bool CryptoScanner::isPemText(const std::string& text){
-    std::istringstream is(text);
-    std::string line;
+bool CryptoScanner::isPemText(std::string_view text){
     int found=0;
-    while(std::getline(is, line)){
+    while(!text.empty()){
+        const std::size_t nl = text.find('\n');
+        const std::string_view line = text.substr(0, nl);
         if(isPemLine(line)) { found++; if(found>=2) return true; }
+        if(nl==std::string_view::npos) break;
+        text.remove_prefix(nl+1);
     }
     return false;
 }
 
 bool CryptoScanner::isLikelyPem(const std::string& path){
-    std::array<char, 4096> buf{};
+    std::array<char, kPemSniffBytes> buf{};
     std::ifstream in(path, std::ios::binary);
     if(!in) return false;
     in.read(buf.data(), (std::streamsize)buf.size());
-    std::string s(buf.data(), (size_t)in.gcount());
-    return isPemText(s);
+    return isPemText(std::string_view(buf.data(), (size_t)in.gcount()));
 }
 
 std::vector<unsigned char> CryptoScanner::b64decode(const std::string& s){
@@ -182,13 +244,26 @@ std::vector<std::vector<unsigned char>> CryptoScanner::pemDecodeAll(const std::s
     return der;
 }
 
-CryptoScanner::CryptoScanner(){
-    auto LR = pattern_loader::loadFromJson();
-    if(!LR.error.empty()){
-        std::cerr << "[CryptoScanner] Warning: failed to load patterns.json: " << LR.error << "\n";
+CryptoScanner::CryptoScanner() : rules(Ruleset::refresh()) { resetRegexBudget(); }
+
+void CryptoScanner::setOptions(const ScanOptions& opt){
+    options = opt;
+    resetRegexBudget();
+}
+
+void CryptoScanner::resetRegexBudget(){
+    regexBudget = std::make_shared<RegexBudget>(rules->patterns.size(), options.regexMaxInput, options.regexBudgetMs);
+}
+
+void CryptoScanner::collectRegexBudget(ScanStats& stats) const {
+    for(std::size_t i=0; i<regexBudget->size(); ++i){
+        const std::uint64_t n = regexBudget->exceeded(i);
+        if(!n) continue;
+        stats.regexBudgetExceeded += n;
+        stats.regexBudgetByPattern[rules->patterns[i].name] += n;
+        if(regexBudget->demoted(i)) stats.regexPatternsDemoted++;
+        if(regexBudget->skipped(i)) stats.regexPatternsSkipped++;
     }
-    patterns        = LR.regexPatterns;
-    oidBytePatterns = LR.bytePatterns;
 }
 
 std::string CryptoScanner::severityForTextPattern(const std::string& algName, const std::string& matched){
@@ -227,39 +302,76 @@ static void add_ast_unique(std::vector<Detection>& out, std::unordered_set<std::
 }
 
 static void match_patterns_over_candidates(const std::vector<AlgorithmPattern>& patterns,
-                                           const std::vector<std::string>& candidates,
+                                           const MultiRegex* engine, const RegexPrefilter* prefilter,
+                                           RegexBudget& budget,
+                                           std::initializer_list<std::string_view> candidates,
                                            const std::string& file, std::size_t line,
                                            std::vector<Detection>& out,
                                            std::unordered_set<std::string>& seen,
                                            const std::function<std::string(const std::string&, const std::string&)>& sevFn){
+    const bool usePrefilter = prefilter && prefilter->size()==patterns.size();
+    if(engine && engine->size()!=patterns.size()) engine = nullptr;
+    std::vector<std::uint8_t> marks;
+    std::vector<RegexBudget::Span> spans;
     for(const auto& cand: candidates){
         if(cand.empty()) continue;
-        for(const auto& ap: patterns){
-            try{
-                std::smatch m;
-                if(std::regex_search(cand, m, ap.pattern)){
-                    const std::string hit = m.str(0);
-                    add_ast_unique(out, seen, file, line, ap.name, hit, sevFn(ap.name, hit));
-                }
-            }catch(...){}
+        if(usePrefilter) prefilter->candidates(cand.data(), cand.size(), marks);
+        for(std::size_t pi=0; pi<patterns.size(); ++pi){
+            if(usePrefilter && !marks[pi]) continue;
+            const auto& ap = patterns[pi];
+            spans.clear();
+            budget.find(pi, ap, engine, cand.data(), cand.size(), true, spans);
+            if(spans.empty()) continue;
+            const std::string hit(cand.substr(spans[0].begin, spans[0].end - spans[0].begin));
+            add_ast_unique(out, seen, file, line, ap.name, hit, sevFn(ap.name, hit));
         }
     }
 }
 
-std::vector<Detection> CryptoScanner::scanBinaryWholeFile(const std::string& filePath){
+bool CryptoScanner::astGateRejects(std::string_view src) const {
+    return rules->astGate && !rules->astGate->mayMatch(src, options.astRegexFallback);
+}
+
+void CryptoScanner::matchAstSymbols(const std::string& filePath, const std::vector<AstSymbol>& syms,
+                                    std::vector<Detection>& out) const {
+    std::unordered_set<std::string> seen;
+    std::vector<analyzers::AstRuleIndex::Hit> hits;
+    for(const auto& s: syms){
+        if(rules->astRules){
+            hits.clear();
+            rules->astRules->match(s, hits, options.regexMaxInput);
+            for(const auto& h: hits) add_ast_unique(out, seen, filePath, s.line, *h.algorithm, h.match, *h.severity);
+        }
+        if(!options.astRegexFallback) continue;
+        const std::string_view base = s.callee_base != s.callee_full ? s.callee_base : std::string_view();
+        match_patterns_over_candidates(rules->patterns, rules->regexEngine.get(), rules->regexPrefilter.get(), *regexBudget,
+                                       { s.callee_full, base, s.first_arg }, filePath, s.line, out, seen,
+                                       [&](const std::string& a, const std::string& m){ return severityForTextPattern(a, m); });
+    }
+}
+
+std::vector<Detection> CryptoScanner::scanBinaryWholeFile(const std::string& filePath) const {
+    return scanBinaryWholeFile(filePath, (std::uint64_t)getFileSizeSafe(filePath));
+}
+
+std::vector<Detection> CryptoScanner::scanBinaryWholeFile(const std::string& filePath, std::uint64_t knownSize) const {
+    if(knownSize >= options.streamThreshold) return scanBinaryStreaming(filePath, options.streamWindow);
+    MappedFile f;
+    if(!f.open(filePath)) return {};
+    return scanBinaryWholeFile(filePath, f);
+}
+
+std::vector<Detection> CryptoScanner::scanBinaryWholeFile(const std::string& filePath, const MappedFile& file) const {
     std::vector<Detection> results;
-    std::vector<unsigned char> data;
-    if(!readAllBytes(filePath, data)) return results;
 
-    auto strings     = FileScanner::extractAsciiStrings(data);
-    auto textMatches = FileScanner::scanStringsWithOffsets(strings, patterns);
-    auto oidMatches  = FileScanner::scanBytesWithOffsets(data, oidBytePatterns);
+    auto strings     = FileScanner::extractAsciiStrings(file.data(), file.size());
+    auto textMatches = FileScanner::scanStringsWithOffsets(strings, rules->patterns, rules->regexEngine.get(), rules->regexPrefilter.get(), regexBudget.get());
+    auto oidMatches  = FileScanner::scanBytesWithOffsets(file.data(), file.size(), rules->oidBytePatterns, rules->byteMatcher.get());
 
+    ContextLowerCache ctxLower;
     for(const auto& alg : textMatches){
         for(const auto& e : alg.second){
-            const AsciiString* ctx = findContextString(strings, e.second);
-            std::string ctxLower = ctx ? toLowerStr(ctx->text) : std::string();
-            if(isIsolatedNoiseToken(alg.first, e.first, ctxLower)) continue;
+            if(isIsolatedNoiseToken(alg.first, e.first, ctxLower.of(strings, e.second))) continue;
             results.push_back({ filePath, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
         }
     }
@@ -271,124 +383,264 @@ std::vector<Detection> CryptoScanner::scanBinaryWholeFile(const std::string& fil
     return results;
 }
 
-std::vector<Detection> CryptoScanner::scanClassFileDetailed(const std::string& filePath){
-    std::vector<Detection> out;
-    std::vector<unsigned char> data;
-    if(!readAllBytes(filePath, data)) return out;
+std::vector<Detection> CryptoScanner::scanBinaryStreaming(const std::string& filePath, std::size_t window) const {
+    std::vector<Detection> results;
+    std::ifstream in(filePath, std::ios::binary);
+    if(!in) return results;
 
-    auto strings     = FileScanner::extractAsciiStrings(data);
-    auto textMatches = FileScanner::scanStringsWithOffsets(strings, patterns);
-    auto oidMatches  = FileScanner::scanBytesWithOffsets(data, oidBytePatterns);
+    std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>> textMatches, oidMatches;
+    FileScanner::scanStreamWithOffsets(in, window, rules->patterns, rules->oidBytePatterns, *rules->byteMatcher,
+                                       rules->regexEngine.get(), rules->regexPrefilter.get(), regexBudget.get(),
+                                       textMatches, oidMatches);
 
     for(const auto& alg : textMatches){
         for(const auto& e : alg.second){
-            const AsciiString* ctx = findContextString(strings, e.second);
-            std::string ctxLower = ctx ? toLowerStr(ctx->text) : std::string();
-            if(isIsolatedNoiseToken(alg.first, e.first, ctxLower)) continue;
-            out.push_back({ filePath, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
+            results.push_back({ filePath, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
         }
     }
     for(const auto& alg : oidMatches){
         for(const auto& e : alg.second){
-            out.push_back({ filePath, e.second, alg.first, e.first, evidenceLabelForByteType("oid"), severityForByteType("oid") });
+            results.push_back({ filePath, e.second, alg.first, e.first, evidenceLabelForByteType("oid"), severityForByteType("oid") });
         }
     }
+    return results;
+}
+
+std::vector<Detection> CryptoScanner::scanClassFileDetailed(const std::string& filePath) const {
+    MappedFile f;
+    if(!f.open(filePath)) return {};
+    return scanClassFileDetailed(filePath, f);
+}
 
-    auto bc = analyzers::JavaBytecodeScanner::scanClassBytes(filePath, data);
-    out.insert(out.end(), bc.begin(), bc.end());
+std::vector<Detection> CryptoScanner::scanClassFileDetailed(const std::string& filePath, const MappedFile& file) const {
+    std::vector<Detection> out;
+    scanClassData(filePath, file.data(), file.size(), nullptr, out);
     return out;
 }
 
-std::vector<Detection> CryptoScanner::scanJarFileDetailed(const std::string& filePath){
-    return scanJarViaMiniZ(filePath);
+void CryptoScanner::scanClassData(const std::string& displayPath, const unsigned char* data, std::size_t size,
+                                  const std::unordered_map<std::string, std::string>* byteTypes,
+                                  std::vector<Detection>& out) const {
+    // One pass over the constant pool yields both the strings for the text patterns and
+    // the heuristic markers; a malformed class falls back to scanning all printable runs.
+    analyzers::ClassConstants cp;
+    const bool parsed = analyzers::JavaBytecodeScanner::parseConstantPool(data, size, cp);
+    std::vector<AsciiString> fallback;
+    if(!parsed) fallback = FileScanner::extractAsciiStrings(data, size);
+    const std::vector<AsciiString>& strings = parsed ? cp.strings : fallback;
+
+    auto textMatches = FileScanner::scanStringsWithOffsets(strings, rules->patterns, rules->regexEngine.get(), rules->regexPrefilter.get(), regexBudget.get());
+    auto oidMatches  = FileScanner::scanBytesWithOffsets(data, size, rules->oidBytePatterns, rules->byteMatcher.get());
+
+    ContextLowerCache ctxLower;
+    for(const auto& alg : textMatches){
+        for(const auto& e : alg.second){
+            if(isIsolatedNoiseToken(alg.first, e.first, ctxLower.of(strings, e.second))) continue;
+            out.push_back({ displayPath, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
+        }
+    }
+    for(const auto& alg : oidMatches){
+        std::string et = "oid";
+        if(byteTypes){
+            auto bt = byteTypes->find(alg.first);
+            et = bt != byteTypes->end() ? bt->second : std::string();
+        }
+        for(const auto& e : alg.second){
+            out.push_back({ displayPath, e.second, alg.first, e.first, evidenceLabelForByteType(et), severityForByteType(et) });
+        }
+    }
+
+    if(parsed){
+        auto bc = analyzers::JavaBytecodeScanner::scanConstants(displayPath, cp);
+        out.insert(out.end(), bc.begin(), bc.end());
+    }
 }
 
-std::vector<Detection> CryptoScanner::scanJarViaMiniZ(const std::string& filePath){
+std::vector<Detection> CryptoScanner::scanJarFileDetailed(const std::string& filePath) const {
+    MappedFile f;
+    if(!f.open(filePath)) return {};
+    return scanJarViaMiniZ(filePath, f);
+}
+
+std::vector<Detection> CryptoScanner::scanJarViaMiniZ(const std::string& filePath, const MappedFile& file) const {
     std::vector<Detection> results;
-#ifndef USE_MINIZ
-    (void)filePath;
+    std::atomic<std::uint64_t> expanded{0};
+    scanArchiveBytes(filePath, file.data(), file.size(), 0, expanded, results);
     return results;
-#else
-    mz_zip_archive zip; std::memset(&zip, 0, sizeof(zip));
-    if(!mz_zip_reader_init_file(&zip, filePath.c_str(), 0)){
-        return results;
+}
+
+#ifdef USE_MINIZ
+// Inflate target reused across entries, one per nesting level: an inner archive is
+// read out of its parent's buffer while its own entries are inflated. The buffers
+// outlive the scan on every pool thread (and in the GUI, the process), so only
+// entries up to kMaxRetainedBytes use them; larger ones (nested archives, native
+// libraries) get a one-off allocation in oversize that is freed with the entry.
+static unsigned char* inflateBuffer(std::size_t depth, std::size_t size, std::vector<unsigned char>& oversize){
+    constexpr std::size_t kMaxRetainedBytes = 1024u * 1024u;
+    if(size > kMaxRetainedBytes){
+        oversize.resize(size);
+        return oversize.data();
     }
-    const int n = (int)mz_zip_reader_get_num_files(&zip);
+    thread_local std::vector<std::vector<unsigned char>> buffers;
+    if(buffers.size() <= depth) buffers.resize(depth + 1);
+    std::vector<unsigned char>& buf = buffers[depth];
+    if(buf.size() < size) buf.resize(size);
+    return buf.data();
+}
+#endif
 
-    std::unordered_map<std::string,std::string> byteType;
-    for(const auto& bp: oidBytePatterns) byteType[bp.name] = bp.type;
+bool CryptoScanner::scanArchiveBytes(const std::string& displayPath, const unsigned char* archive, std::size_t archiveSize,
+                                     std::size_t depth, std::atomic<std::uint64_t>& expanded, std::vector<Detection>& results) const {
+#ifndef USE_MINIZ
+    (void)displayPath; (void)archive; (void)archiveSize; (void)depth; (void)expanded; (void)results;
+    return false;
+#else
+    // The central directory is read once here; workers then only need this table
+    // and the archive bytes, never the shared mz_zip_archive.
+    struct ZipEntry {
+        std::string   name;
+        std::uint64_t localHeader, compSize, uncompSize;
+        mz_uint32     crc;
+        mz_uint16     method;
+    };
+    std::vector<ZipEntry> entries;
+    {
+        mz_zip_archive zip; std::memset(&zip, 0, sizeof(zip));
+        if(!mz_zip_reader_init_mem(&zip, archive, archiveSize, 0)){
+            return false;
+        }
+        const mz_uint n = mz_zip_reader_get_num_files(&zip);
+        entries.reserve(n);
+        for(mz_uint i=0; i<n; ++i){
+            mz_zip_archive_file_stat st;
+            if(!mz_zip_reader_file_stat(&zip, i, &st)) continue;
+            if(st.m_is_directory || !st.m_is_supported || st.m_is_encrypted) continue;
+            if(st.m_method != 0 && st.m_method != MZ_DEFLATED) continue;
+            if(options.archiveSelectEntries && !isScannableArchiveEntry(st.m_filename)) continue;
+            entries.push_back({ st.m_filename, st.m_local_header_ofs, st.m_comp_size, st.m_uncomp_size, st.m_crc32, st.m_method });
+        }
+        mz_zip_reader_end(&zip);
+    }
 
-    std::unordered_set<std::string> seen;
+    const auto& byteType = rules->byteTypes;
 
-    for(int i=0; i<n; ++i){
-        mz_zip_archive_file_stat st;
-        if(!mz_zip_reader_file_stat(&zip, i, &st)) continue;
-        if(st.m_is_directory) continue;
+    // entries left out by the bomb limits, reported below so a cut-short archive does not look clean
+    std::atomic<std::uint64_t> overRatio{0}, overExpanded{0}, overExpandedBytes{0};
 
-        std::string entry = st.m_filename;
+    auto scanEntry = [&](const ZipEntry& ze, std::vector<Detection>& out){
+        if(ze.compSize > 0 && ze.uncompSize / ze.compSize > options.archiveMaxRatio){
+            overRatio++;
+            return;
+        }
+        if(expanded.fetch_add(ze.uncompSize) + ze.uncompSize > options.archiveMaxExpandedBytes){
+            overExpanded++;
+            overExpandedBytes += ze.uncompSize;
+            return;
+        }
 
-        size_t out_size = 0;
-        void* p = mz_zip_reader_extract_to_heap(&zip, i, &out_size, 0);
-        if(!p) continue;
-        std::vector<unsigned char> data((unsigned char*)p, (unsigned char*)p + out_size);
-        mz_free(p);
+        // local header: 30 fixed bytes, then file name and extra field
+        const std::uint64_t lh = ze.localHeader;
+        if(lh > archiveSize || archiveSize - lh < 30) return;
+        const unsigned char* h = archive + lh;
+        if(h[0]!='P' || h[1]!='K' || h[2]!=3 || h[3]!=4) return;
+        const std::uint64_t dataOfs = lh + 30 + (h[26] | (h[27] << 8)) + (h[28] | (h[29] << 8));
+        if(dataOfs > archiveSize || archiveSize - dataOfs < ze.compSize) return;
+        const unsigned char* src = archive + dataOfs;
+
+        // stored entries are scanned in place on the archive mapping
+        const unsigned char* data = src;
+        const std::size_t size = (std::size_t)ze.uncompSize;
+        std::vector<unsigned char> oversize;
+        if(ze.method == MZ_DEFLATED){
+            unsigned char* buf = inflateBuffer(depth, size, oversize);
+            if(tinfl_decompress_mem_to_mem(buf, size, src, (std::size_t)ze.compSize,
+                                           TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) != size) return;
+            data = buf;
+        }else if(ze.compSize != ze.uncompSize){
+            return;
+        }
+        if(mz_crc32(MZ_CRC32_INIT, data, size) != ze.crc) return;
 
-        const std::string display = filePath + "::" + entry;
-        std::string ext = lowercaseExt(entry);
+        const std::string display = displayPath + "::" + ze.name;
+        std::string ext = lowercaseExt(ze.name);
         bool isSrc = (ext==".java");
 
+        if(isArchiveExt(ext) && depth < options.archiveMaxDepth
+           && scanArchiveBytes(display, data, size, depth + 1, expanded, out)){
+            return;
+        }
+        if(ends_with(ze.name, ".class")){
+            scanClassData(display, data, size, &byteType, out);
+            return;
+        }
+
         if(!isSrc){
-            auto strings     = FileScanner::extractAsciiStrings(data);
-            auto textMatches = FileScanner::scanStringsWithOffsets(strings, patterns);
-            auto oidMatches  = FileScanner::scanBytesWithOffsets(data, oidBytePatterns);
+            auto strings     = FileScanner::extractAsciiStrings(data, size);
+            auto textMatches = FileScanner::scanStringsWithOffsets(strings, rules->patterns, rules->regexEngine.get(), rules->regexPrefilter.get(), regexBudget.get());
+            auto oidMatches  = FileScanner::scanBytesWithOffsets(data, size, rules->oidBytePatterns, rules->byteMatcher.get());
 
+            ContextLowerCache ctxLower;
             for(const auto& alg : textMatches){
                 for(const auto& e : alg.second){
-                    const AsciiString* ctx = findContextString(strings, e.second);
-                    std::string ctxLower = ctx ? toLowerStr(ctx->text) : std::string();
-                    if(isIsolatedNoiseToken(alg.first, e.first, ctxLower)) continue;
-                    results.push_back({ display, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
+                    if(isIsolatedNoiseToken(alg.first, e.first, ctxLower.of(strings, e.second))) continue;
+                    out.push_back({ display, e.second, alg.first, e.first, evidenceTypeForTextPattern(alg.first), severityForTextPattern(alg.first, e.first) });
                 }
             }
             for(const auto& alg : oidMatches){
-                const std::string et = byteType.count(alg.first)? byteType[alg.first] : std::string();
+                auto bt = byteType.find(alg.first);
+                const std::string et = bt != byteType.end() ? bt->second : std::string();
                 for(const auto& e : alg.second){
-                    results.push_back({ display, e.second, alg.first, e.first, evidenceLabelForByteType(et), severityForByteType(et) });
+                    out.push_back({ display, e.second, alg.first, e.first, evidenceLabelForByteType(et), severityForByteType(et) });
                 }
             }
         }
 
-        if(ends_with(entry, ".class")){
-            auto bc = analyzers::JavaBytecodeScanner::scanClassBytes(display, data);
-            results.insert(results.end(), bc.begin(), bc.end());
-        }
-        if(ends_with(entry, ".java")){
-            std::string src((const char*)data.data(), data.size());
-            auto syms = analyzers::JavaASTScanner::collectSymbols(display, src);
-            for(const auto& s: syms){
-                std::vector<std::string> cands;
-                cands.push_back(s.callee_full);
-                if(s.callee_base != s.callee_full) cands.push_back(s.callee_base);
-                if(!s.first_arg.empty()) cands.push_back(s.first_arg);
-                match_patterns_over_candidates(patterns, cands, s.filePath, s.line, results, seen,
-                                               [&](const std::string& a, const std::string& m){ return severityForTextPattern(a, m); });
-            }
+        if(ends_with(ze.name, ".java")){
+            const std::string_view src((const char*)data, size);
+            if(!astGateRejects(src)) matchAstSymbols(display, analyzers::JavaASTScanner::collectSymbols(src), out);
         }
+    };
+
+    // Entries are spread over the pool this scan runs on (if any); per-entry
+    // results are merged in entry order.
+    WorkStealingPool* pool = WorkStealingPool::current();
+    if(!pool || entries.size() < 2){
+        for(const auto& ze: entries) scanEntry(ze, results);
+    }else{
+        std::vector<std::vector<Detection>> perEntry(entries.size());
+        pool->parallelFor(entries.size(), [&](std::size_t i){ scanEntry(entries[i], perEntry[i]); });
+        for(auto& v: perEntry) results.insert(results.end(), std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
     }
 
-    mz_zip_reader_end(&zip);
-    return results;
+    if(overRatio || overExpanded){
+        auto count = [](std::uint64_t n){ return std::to_string(n) + (n == 1 ? " entry" : " entries"); };
+        std::string what;
+        if(overRatio){
+            what = count(overRatio) + " over " + std::to_string(options.archiveMaxRatio) + "x compression";
+        }
+        if(overExpanded){
+            if(!what.empty()) what += ", ";
+            what += count(overExpanded) + " (" + std::to_string(overExpandedBytes.load())
+                  + " bytes) past the " + std::to_string(options.archiveMaxExpandedBytes) + "-byte expansion limit";
+        }
+        results.push_back({ displayPath, 0, "Archive not fully scanned", "skipped " + what, "archive-limit", "low" });
+    }
+    return true;
 #endif
 }
 
-std::vector<Detection> CryptoScanner::scanCertOrKeyFileDetailed(const std::string& filePath){
+std::vector<Detection> CryptoScanner::scanCertOrKeyFileDetailed(const std::string& filePath) const {
+    MappedFile f;
+    if(!f.open(filePath)) return {};
+    return scanCertOrKeyFileDetailed(filePath, f);
+}
+
+std::vector<Detection> CryptoScanner::scanCertOrKeyFileDetailed(const std::string& filePath, const MappedFile& file) const {
     std::vector<Detection> out;
-    std::string text;
-    readTextFile(filePath, text);
-    if(isPemText(text)){
-        auto all = pemDecodeAll(text);
+    if(isPemText(file.view())){
+        auto all = pemDecodeAll(std::string(file.view()));
         for(const auto& der: all){
-            auto oidMatches = FileScanner::scanBytesWithOffsets(der, oidBytePatterns);
+            auto oidMatches = FileScanner::scanBytesWithOffsets(der, rules->oidBytePatterns, rules->byteMatcher.get());
             for(const auto& alg : oidMatches){
                 for(const auto& e : alg.second){
                     out.push_back({ filePath, e.second, alg.first, e.first, evidenceLabelForByteType("oid"), severityForByteType("oid") });
@@ -398,92 +650,111 @@ std::vector<Detection> CryptoScanner::scanCertOrKeyFileDetailed(const std::strin
         return out;
     }
 
-    std::vector<unsigned char> data;
-    if(readAllBytes(filePath, data)){
-        auto oidMatches = FileScanner::scanBytesWithOffsets(data, oidBytePatterns);
-        for(const auto& alg : oidMatches){
-            for(const auto& e : alg.second){
-                out.push_back({ filePath, e.second, alg.first, e.first, evidenceLabelForByteType("oid"), severityForByteType("oid") });
-            }
+    auto oidMatches = FileScanner::scanBytesWithOffsets(file.data(), file.size(), rules->oidBytePatterns, rules->byteMatcher.get());
+    for(const auto& alg : oidMatches){
+        for(const auto& e : alg.second){
+            out.push_back({ filePath, e.second, alg.first, e.first, evidenceLabelForByteType("oid"), severityForByteType("oid") });
         }
     }
     return out;
 }
 
-std::vector<Detection> CryptoScanner::scanFileDetailed(const std::string& filePath){
+std::vector<Detection> CryptoScanner::scanFileDetailed(const std::string& filePath) const {
+    return scanFileDetailed(filePath, (std::uint64_t)getFileSizeSafe(filePath));
+}
+
+std::vector<Detection> CryptoScanner::scanFileDetailed(const std::string& filePath, std::uint64_t knownSize,
+                                                       bool* astSkipped) const {
     std::vector<Detection> out;
     const std::string ext = lowercaseExt(filePath);
 
-    if(ext==".jar" || ext==".zip"){
-        auto v = scanJarFileDetailed(filePath);
+    static const std::unordered_set<std::string> structuredExts = {
+        ".class",".java",".py",".c",".cc",".cpp",".cxx",".h",".hpp",".hh",".ld"
+    };
+    // without deepJar an archive is scanned as the bytes on disk, like any binary
+    const bool openArchive = options.deepJar && isArchiveExt(ext);
+    if(!openArchive && !structuredExts.count(ext) && !isCertOrKeyExt(ext) && knownSize >= options.streamThreshold
+       && !isLikelyPem(filePath)){
+        return scanBinaryStreaming(filePath, options.streamWindow);
+    }
+
+    MappedFile file;
+    if(!file.open(filePath)) return out;
+
+    if(openArchive){
+        auto v = scanJarViaMiniZ(filePath, file);
         out.insert(out.end(), v.begin(), v.end());
         return out;
     }
     if(ext==".class"){
-        auto v = scanClassFileDetailed(filePath);
+        auto v = scanClassFileDetailed(filePath, file);
         out.insert(out.end(), v.begin(), v.end());
         return out;
     }
-    if(isCertOrKeyExt(ext) || isLikelyPem(filePath)){
-        auto v = scanCertOrKeyFileDetailed(filePath);
+    if(isCertOrKeyExt(ext) || isPemText(file.view().substr(0, kPemSniffBytes))){
+        auto v = scanCertOrKeyFileDetailed(filePath, file);
         out.insert(out.end(), v.begin(), v.end());
         return out;
     }
 
-    if(ext==".java"){
-        std::string code; readTextFile(filePath, code);
-        auto syms = analyzers::JavaASTScanner::collectSymbols(filePath, code);
-        std::unordered_set<std::string> seen;
-        for(const auto& s: syms){
-            std::vector<std::string> cands;
-            cands.push_back(s.callee_full);
-            if(s.callee_base != s.callee_full) cands.push_back(s.callee_base);
-            if(!s.first_arg.empty()) cands.push_back(s.first_arg);
-            match_patterns_over_candidates(patterns, cands, s.filePath, s.line, out, seen,
-                                           [&](const std::string& a, const std::string& m){ return severityForTextPattern(a, m); });
-        }
+    const bool isJava = ext==".java", isPython = ext==".py";
+    const bool isCpp = ext==".c" || ext==".cc" || ext==".cpp" || ext==".cxx" || ext==".h" || ext==".hpp" || ext==".hh" || ext==".ld";
+    if((isJava || isPython || isCpp) && astGateRejects(file.view())){
+        if(astSkipped) *astSkipped = true;
         return out;
-    } else if(ext==".py"){
-        auto syms = analyzers::PythonASTScanner::collectSymbols(filePath);
-        std::unordered_set<std::string> seen;
-        for(const auto& s: syms){
-            std::vector<std::string> cands;
-            cands.push_back(s.callee_full);
-            if(s.callee_base != s.callee_full) cands.push_back(s.callee_base);
-            if(!s.first_arg.empty()) cands.push_back(s.first_arg);
-            match_patterns_over_candidates(patterns, cands, s.filePath, s.line, out, seen,
-                                           [&](const std::string& a, const std::string& m){ return severityForTextPattern(a, m); });
-        }
+    }
+
+    if(isJava){
+        matchAstSymbols(filePath, analyzers::JavaASTScanner::collectSymbols(file.view()), out);
         return out;
-    } else if(ext==".c" || ext==".cc" || ext==".cpp" || ext==".cxx" || ext==".h" || ext==".hpp" || ext==".hh" || ext==".ld"){
-        auto syms = analyzers::CppASTScanner::collectSymbols(filePath);
-        std::unordered_set<std::string> seen;
-        for(const auto& s: syms){
-            std::vector<std::string> cands;
-            cands.push_back(s.callee_full);
-            if(s.callee_base != s.callee_full) cands.push_back(s.callee_base);
-            if(!s.first_arg.empty()) cands.push_back(s.first_arg);
-            match_patterns_over_candidates(patterns, cands, s.filePath, s.line, out, seen,
-                                           [&](const std::string& a, const std::string& m){ return severityForTextPattern(a, m); });
-        }
+    } else if(isPython){
+        matchAstSymbols(filePath, analyzers::PythonASTScanner::collectSymbols(file.view()), out);
+        return out;
+    } else if(isCpp){
+        matchAstSymbols(filePath, analyzers::CppASTScanner::collectSymbols(file.view()), out);
         return out;
     }
 
-    auto v = scanBinaryWholeFile(filePath);
+    auto v = scanBinaryWholeFile(filePath, file);
     out.insert(out.end(), v.begin(), v.end());
     return out;
 }
 
-std::vector<Detection> CryptoScanner::scanPathRecursive(const std::string& rootPath){
+std::uint64_t CryptoScanner::cacheConfigHash(const ScanOptions& opt) const {
+    std::uint64_t h = content_hash::combine(rules->hash, opt.deepJar ? 1 : 0);
+    h = content_hash::combine(h, opt.archiveMaxDepth);
+    h = content_hash::combine(h, opt.archiveMaxRatio);
+    h = content_hash::combine(h, opt.archiveMaxExpandedBytes);
+    h = content_hash::combine(h, opt.archiveSelectEntries ? 1 : 0);
+    h = content_hash::combine(h, opt.regexMaxInput);
+    return content_hash::combine(h, opt.astRegexFallback ? 1 : 0);
+}
+
+std::vector<Detection> CryptoScanner::scanPathRecursive(const std::string& rootPath) const {
+    std::unique_ptr<ScanCache> cache;
+    if(!options.cachePath.empty()){
+        cache = std::make_unique<ScanCache>(options.cachePath, cacheConfigHash(options));
+        cache->load();
+    }
+
     std::vector<Detection> all;
     for(auto it = fs::recursive_directory_iterator(rootPath, fs::directory_options::skip_permission_denied);
         it != fs::recursive_directory_iterator(); ++it){
         const fs::directory_entry& de = *it;
         if(!de.is_regular_file()) continue;
         std::string path = de.path().string();
-        auto v = scanFileDetailed(path);
+        if(!cache){
+            auto v = scanFileDetailed(path);
+            all.insert(all.end(), v.begin(), v.end());
+            continue;
+        }
+        DirectoryWalker::Entry e;
+        if(!DirectoryWalker::stat(path, e) || cache->lookup(e, all)) continue;
+        auto v = scanFileDetailed(path, e.size);
+        cache->store(e, v);
         all.insert(all.end(), v.begin(), v.end());
     }
+    if(cache) cache->save(underRoot(rootPath));
     return all;
 }
 
@@ -492,8 +763,19 @@ void CryptoScanner::scanPathLikeAntivirus(
     const ScanOptions& opt,
     const std::function<void(const Detection&)>& onDetect,
     const std::function<void(const std::string&, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t)>& onProgress,
-    const std::function<bool()>& isCancelled
+    const std::function<bool()>& isCancelled,
+    ScanStats* stats
 ){
+    options = opt;
+    rules = Ruleset::refresh();
+    resetRegexBudget();
+    // budget counters are final once the workers are gone, however the scan ends
+    struct BudgetReport {
+        const CryptoScanner& sc;
+        ScanStats* stats;
+        ~BudgetReport(){ if(stats) sc.collectRegexBudget(*stats); }
+    } budgetReport{ *this, stats };
+
     std::unordered_set<std::string> hardSkipRoots = {
         "/proc","/sys","/dev","/run","/lost+found"
     };
@@ -506,66 +788,212 @@ void CryptoScanner::scanPathLikeAntivirus(
 
     std::unordered_set<std::string> srcExts = {".c",".cc",".cpp",".cxx",".py",".java",".ld",".h",".hh",".hpp"};
     std::unordered_set<std::string> classExts = {".class"};
-    std::unordered_set<std::string> jarExts = {".jar",".zip"};
+    std::unordered_set<std::string> jarExts = {".jar",".zip",".war",".ear"};
 
-    auto sizeOf = [&](const fs::path& p){ return (std::uint64_t)getFileSizeSafe(p.string()); };
     const std::uint64_t maxSrcSize = 32ull * 1024ull * 1024ull;
     const std::uint64_t maxHdrSize = 8ull  * 1024ull * 1024ull;
     const std::uint64_t maxClassSize = 32ull * 1024ull * 1024ull;
     const std::uint64_t maxArchiveSize = 1024ull * 1024ull * 1024ull;
     const std::uint64_t maxJarDeepBytes = 256ull * 1024ull * 1024ull;
 
-    std::vector<std::string> files;
-    if(fs::is_regular_file(rootPath)){
-        files.push_back(rootPath);
-    }else{
-        for(auto it = fs::recursive_directory_iterator(rootPath, fs::directory_options::skip_permission_denied);
-            it != fs::recursive_directory_iterator(); ++it){
-            if(isCancelled && isCancelled()) return;
-            const fs::directory_entry& de = *it;
-            const fs::path p = de.path();
-
-            bool skip = false;
-            for(const auto& r: hardSkipRoots) if(pathStartsWith(p, r)) { skip=true; break; }
-            if(skip) { it.disable_recursion_pending(); continue; }
-
-            if(de.is_regular_file()){
-                std::string ext = lowercaseExt(p.string());
-                if(srcExts.count(ext)){
-                    if(ext==".h" || ext==".hh" || ext==".hpp"){
-                        if(sizeOf(p) > maxHdrSize) continue;
-                    }else{
-                        if(sizeOf(p) > maxSrcSize) continue;
-                    }
-                }
-                if(classExts.count(ext) && sizeOf(p) > maxClassSize) continue;
-                if(jarExts.count(ext) && sizeOf(p) > maxArchiveSize) continue;
-                files.push_back(p.string());
-            }
-        }
-    }
+    // callbacks (including isCancelled) are only ever invoked under cbMutex
+    std::mutex cbMutex;
+    std::atomic<bool> cancelled{false};
+    auto checkCancelled = [&]{
+        if(cancelled.load()) return true;
+        std::lock_guard<std::mutex> lk(cbMutex);
+        if(isCancelled && isCancelled()) cancelled.store(true);
+        return cancelled.load();
+    };
 
-    std::uint64_t totalFiles = files.size();
+    const std::size_t poolThreads = opt.threads ? opt.threads : WorkStealingPool::defaultThreads();
+
+    // totals grow while the walk is still running; all counters are guarded by cbMutex
+    std::uint64_t totalFiles = 0;
     std::uint64_t doneFiles = 0;
     std::uint64_t totalBytes = 0;
     std::uint64_t doneBytes = 0;
-    for(const auto& f: files) totalBytes += getFileSizeSafe(f);
-
-    for(const auto& cur: files){
-        if(isCancelled && isCancelled()) return;
-        fs::path p(cur);
-        std::string ext = lowercaseExt(cur);
-        std::vector<Detection> v;
-        if(ext==".jar" && opt.deepJar){
-            if(sizeOf(p) > maxJarDeepBytes) v = scanBinaryWholeFile(cur);
-            else v = scanJarFileDetailed(cur);
-        }else{
-            v = scanFileDetailed(cur);
-        }
-        for(const auto& d: v) onDetect(d);
+
+    std::unique_ptr<ScanCache> cache;
+    if(!opt.cachePath.empty()){
+        cache = std::make_unique<ScanCache>(opt.cachePath, cacheConfigHash(opt));
+        cache->load();
+    }
+
+    ContentDedup dedup;
+    // Without the full file list (streaming mode) small files are not worth hashing.
+    const std::uint64_t minDedupSize = 64ull * 1024ull;
+
+    enum class Source { Scanned, Cached, Duplicate };
+    struct Finished { std::vector<Detection> detections; std::uint64_t size; Source source; bool astSkipped = false; };
+    auto report = [&](const std::string& path, const Finished& f){
+        for(const auto& d: f.detections) onDetect(d);
         doneFiles++;
-        const std::uint64_t sz = sizeOf(p);
-        doneBytes += sz;
-        onProgress(cur, doneFiles, totalFiles, doneBytes, totalBytes);
+        doneBytes += f.size;
+        if(stats){
+            stats->filesScanned++;
+            if(f.source == Source::Cached) stats->cacheHits++;
+            else if(cache) stats->cacheMisses++;
+            if(f.source == Source::Scanned) stats->bytesScanned += f.size;
+            if(f.source == Source::Duplicate){
+                stats->duplicateFiles++;
+                stats->duplicateBytes += f.size;
+            }
+            if(f.astSkipped){
+                stats->astSkippedFiles++;
+                stats->astSkippedBytes += f.size;
+            }
+        }
+        onProgress(path, doneFiles, totalFiles, doneBytes, totalBytes);
+    };
+
+    auto scanContent = [&](const DirectoryWalker::Entry& e, bool& astSkipped){
+        if(lowercaseExt(e.path)==".jar" && opt.deepJar){
+            if(e.size > maxJarDeepBytes) return scanBinaryWholeFile(e.path, e.size);
+            return scanJarFileDetailed(e.path);
+        }
+        return scanFileDetailed(e.path, e.size, &astSkipped);
+    };
+
+    // Hands every file that is finished to done(entry, ticket, result): normally
+    // just e, nothing while e waits for an identical file still being scanned,
+    // and e followed by its waiting copies when e is that file.
+    using Done = std::function<void(const DirectoryWalker::Entry&, std::size_t, Finished&&)>;
+    auto scanOne = [&](const DirectoryWalker::Entry& e, std::size_t ticket, bool dedupCandidate, const Done& done){
+        Finished f{ {}, e.size, Source::Scanned };
+        if(cache && cache->lookup(e, f.detections)){
+            f.source = Source::Cached;
+            done(e, ticket, std::move(f));
+            return;
+        }
+        std::uint64_t hash = 0;
+        const int kind = scanKind(lowercaseExt(e.path));
+        const bool hashed = dedupCandidate && opt.dedupContent && e.size > 0 && e.size < opt.streamThreshold
+                         && ContentDedup::hashFile(e.path, hash);
+        if(hashed){
+            const auto claim = dedup.claim(e, hash, kind, ticket, f.detections);
+            if(claim == ContentDedup::Claim::Pending) return;
+            if(claim == ContentDedup::Claim::Duplicate){
+                f.source = Source::Duplicate;
+                if(cache) cache->store(e, f.detections);
+                done(e, ticket, std::move(f));
+                return;
+            }
+        }
+        f.detections = scanContent(e, f.astSkipped);
+        if(cache) cache->store(e, f.detections);
+        std::vector<ContentDedup::Waiter> copies;
+        if(hashed) copies = dedup.publish(e, hash, kind, f.detections);
+        done(e, ticket, std::move(f));
+        for(auto& w: copies){
+            if(cache) cache->store(w.entry, w.detections);
+            done(w.entry, w.ticket, Finished{ std::move(w.detections), w.entry.size, Source::Duplicate });
+        }
+    };
+
+    DirectoryWalker::Entry rootEntry;
+    if(DirectoryWalker::stat(rootPath, rootEntry)){
+        if(checkCancelled()) return;
+        {
+            std::lock_guard<std::mutex> lk(cbMutex);
+            totalFiles = 1;
+            totalBytes = rootEntry.size;
+        }
+        scanOne(rootEntry, 0, false, [&](const DirectoryWalker::Entry&, std::size_t, Finished&& f){
+            std::lock_guard<std::mutex> lk(cbMutex);
+            if(!cancelled.load()) report(rootPath, f);
+        });
+        // a single file says nothing about the rest of the cache
+        if(cache) cache->save();
+        return;
+    }
+
+    auto skipPath = [&](const std::string& p){
+        for(const auto& r: hardSkipRoots) if(pathStartsWith(p, r)) return true;
+        return false;
+    };
+    auto accept = [&](const DirectoryWalker::Entry& e){
+        std::string ext = lowercaseExt(e.path);
+        if(srcExts.count(ext)){
+            if(ext==".h" || ext==".hh" || ext==".hpp"){
+                if(e.size > maxHdrSize) return false;
+            }else{
+                if(e.size > maxSrcSize) return false;
+            }
+        }
+        if(classExts.count(ext) && e.size > maxClassSize) return false;
+        if(jarExts.count(ext) && e.size > maxArchiveSize) return false;
+        return true;
+    };
+
+    WorkStealingPool pool(poolThreads);
+
+    if(!opt.deterministicOrder){
+        // files are scanned on the same pool as soon as the walk finds them
+        const Done reportNow = [&](const DirectoryWalker::Entry& e, std::size_t, Finished&& f){
+            std::lock_guard<std::mutex> lk(cbMutex);
+            if(!cancelled.load()) report(e.path, f);
+        };
+        auto onFile = [&](DirectoryWalker::Entry&& e){
+            if(!accept(e)) return;
+            {
+                std::lock_guard<std::mutex> lk(cbMutex);
+                ++totalFiles;
+                totalBytes += e.size;
+            }
+            pool.submit([&, e = std::move(e)]{
+                if(checkCancelled()) return;
+                scanOne(e, 0, e.size >= minDedupSize, reportNow);
+            });
+        };
+        DirectoryWalker::walk(rootPath, pool, skipPath, onFile, checkCancelled, opt.recurse);
+        pool.wait();
+        if(cache) cache->save(cancelled.load() ? nullptr : underRoot(rootPath, opt.recurse));
+        return;
+    }
+
+    // Reproducible order needs the whole list first: walk, sort, then scan and
+    // report finished files strictly in sorted order.
+    std::vector<DirectoryWalker::Entry> files;
+    std::mutex filesMutex;
+    DirectoryWalker::walk(rootPath, pool, skipPath, [&](DirectoryWalker::Entry&& e){
+        if(!accept(e)) return;
+        std::lock_guard<std::mutex> lk(filesMutex);
+        files.push_back(std::move(e));
+    }, checkCancelled, opt.recurse);
+    pool.wait();
+    if(checkCancelled()) return;
+    std::sort(files.begin(), files.end(),
+              [](const DirectoryWalker::Entry& a, const DirectoryWalker::Entry& b){ return a.path < b.path; });
+
+    {
+        std::lock_guard<std::mutex> lk(cbMutex);
+        totalFiles = files.size();
+        for(const auto& e: files) totalBytes += e.size;
+    }
+
+    // only files sharing their size with another file can be copies
+    std::unordered_map<std::uint64_t, std::size_t> sizeCount;
+    for(const auto& e: files) sizeCount[e.size]++;
+
+    std::map<std::size_t, Finished> parked;
+    std::size_t nextToReport = 0;
+    const Done reportInOrder = [&](const DirectoryWalker::Entry&, std::size_t i, Finished&& f){
+        std::lock_guard<std::mutex> lk(cbMutex);
+        if(cancelled.load()) return;
+        parked.emplace(i, std::move(f));
+        for(auto it = parked.find(nextToReport); it != parked.end(); it = parked.find(nextToReport)){
+            report(files[it->first].path, it->second);
+            parked.erase(it);
+            ++nextToReport;
+        }
+    };
+    for(std::size_t i=0; i<files.size(); ++i){
+        pool.submit([&, i]{
+            if(checkCancelled()) return;
+            scanOne(files[i], i, sizeCount.at(files[i].size) > 1, reportInOrder);
+        });
     }
+    pool.wait();
+    if(cache) cache->save(cancelled.load() ? nullptr : underRoot(rootPath, opt.recurse));
 }
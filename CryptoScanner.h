@@ -2,12 +2,21 @@
 
 #include "PatternDefinitions.h"
 #include "FileScanner.h"
+#include "MappedFile.h"
+#include "Ruleset.h"
 
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <unordered_map>
 #include <functional>
+#include <map>
+#include <memory>
+
+struct AstSymbol;
+class RegexBudget;
 
 struct Detection {
     std::string filePath;
@@ -19,26 +28,94 @@ struct Detection {
 };
 
 struct ScanOptions {
+    // Without recurse a directory root is scanned without its subdirectories.
     bool recurse = true;
+    // Open JAR/ZIP/WAR/EAR archives and the archives nested in them; without it
+    // an archive is scanned as a plain binary.
     bool deepJar = true;
+    // Binaries of at least streamThreshold bytes are scanned streamWindow bytes at a time.
+    std::uint64_t streamThreshold = 512ull * 1024ull * 1024ull;
+    std::size_t   streamWindow    = 16u * 1024u * 1024u;
+    // Worker threads for scanPathLikeAntivirus; 0 means one per hardware thread.
+    std::size_t   threads = 0;
+    // Report files in enumeration order instead of completion order.
+    bool          deterministicOrder = false;
+    // Incremental scan cache file; empty disables it. Unchanged files replay their
+    // cached detections without being opened.
+    std::string   cachePath;
+    // Scan files with identical content once and re-emit the detections under
+    // each copy's path.
+    bool          dedupContent = true;
+    // Archives inside archives (fat JAR, WAR, EAR) are opened from memory down to
+    // archiveMaxDepth levels. Entries claiming more than archiveMaxRatio times their
+    // compressed size are skipped, and expansion of one outer archive stops after
+    // archiveMaxExpandedBytes. An archive with skipped entries gets one low-severity
+    // "archive-limit" detection saying how many.
+    std::size_t   archiveMaxDepth = 4;
+    std::uint64_t archiveMaxRatio = 100;
+    std::uint64_t archiveMaxExpandedBytes = 1024ull * 1024ull * 1024ull;
+    // Only inflate archive entries that can carry crypto evidence (classes, sources,
+    // configuration, certificates and keys, signature blocks, nested archives,
+    // native libraries); images, fonts and other resources are skipped.
+    bool          archiveSelectEntries = true;
+    // Source files are matched against the AST rule table (ast_rules in patterns.json,
+    // or the built-in rules); this additionally runs every regex pattern over each
+    // call's callee and first argument.
+    bool          astRegexFallback = true;
+    // Guards on std::regex, which still runs patterns MultiRegex cannot put in a DFA
+    // and the AST fallback (see RegexBudget): no pass sees more than regexMaxInput
+    // bytes. Passes are timed after they return, so regexBudgetMs (0: off) cuts no
+    // call short; a pattern slower than that moves to the Pike VM when it can, else
+    // runs on shorter inputs and is skipped once the shortest are still too slow.
+    std::size_t   regexMaxInput = 8 * 1024;
+    unsigned      regexBudgetMs = 20;
+};
+
+struct ScanStats {
+    std::uint64_t filesScanned = 0;
+    std::uint64_t bytesScanned = 0;
+    std::uint64_t cacheHits    = 0;
+    std::uint64_t cacheMisses  = 0;
+    // Copies of already scanned content and the bytes not re-scanned because of them.
+    std::uint64_t duplicateFiles = 0;
+    std::uint64_t duplicateBytes = 0;
+    // Source files not parsed because no rule callee or pattern literal occurs in them.
+    std::uint64_t astSkippedFiles = 0;
+    std::uint64_t astSkippedBytes = 0;
+    // Inputs over regexMaxInput, std::regex calls over regexBudgetMs and calls skipped,
+    // in total and per pattern name; the patterns moved to the Pike VM and those
+    // skipped because of them.
+    std::uint64_t regexBudgetExceeded = 0;
+    std::map<std::string, std::uint64_t> regexBudgetByPattern;
+    std::uint64_t regexPatternsDemoted = 0;
+    std::uint64_t regexPatternsSkipped = 0;
 };
 
 class CryptoScanner {
 public:
     CryptoScanner();
 
-    std::vector<Detection> scanFileDetailed(const std::string& filePath);
-    std::vector<Detection> scanPathRecursive(const std::string& rootPath);
+    std::vector<Detection> scanFileDetailed(const std::string& filePath) const;
+    std::vector<Detection> scanPathRecursive(const std::string& rootPath) const;
 
-    std::vector<Detection> scanClassFileDetailed(const std::string& filePath);
-    std::vector<Detection> scanJarFileDetailed(const std::string& filePath);
-    std::vector<Detection> scanCertOrKeyFileDetailed(const std::string& filePath);
+    std::vector<Detection> scanClassFileDetailed(const std::string& filePath) const;
+    std::vector<Detection> scanJarFileDetailed(const std::string& filePath) const;
+    std::vector<Detection> scanCertOrKeyFileDetailed(const std::string& filePath) const;
 
-    std::vector<Detection> scanBinaryWholeFile(const std::string& filePath);
+    std::vector<Detection> scanBinaryWholeFile(const std::string& filePath) const;
+    std::vector<Detection> scanBinaryStreaming(const std::string& filePath, std::size_t window) const;
+
+    void setOptions(const ScanOptions& opt);
+    const ScanOptions& getOptions() const { return options; }
 
     static std::uintmax_t getFileSizeSafe(const std::string& path);
     static std::string lowercaseExt(const std::string& p);
     static bool isCertOrKeyExt(const std::string& ext);
+    static bool isArchiveExt(const std::string& ext);
+    static bool isScannableArchiveEntry(const std::string& name);
+    // Which scanner a file of this extension goes to; equal content only scans
+    // alike within one kind.
+    static int scanKind(const std::string& ext);
     static bool isLikelyPem(const std::string& path);
     static bool readTextFile(const std::string& path, std::string& out);
     static bool readAllBytes(const std::string& path, std::vector<unsigned char>& out);
@@ -48,21 +125,47 @@ public:
         const ScanOptions& opt,
         const std::function<void(const Detection&)>& onDetect,
         const std::function<void(const std::string&, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t)>& onProgress,
-        const std::function<bool()>& isCancelled
+        const std::function<bool()>& isCancelled,
+        ScanStats* stats = nullptr
     );
 
 private:
-    std::vector<Detection> scanJarViaMiniZ(const std::string& filePath);
+    // knownSize comes from the directory walk, so the file is not stat'ed again by path.
+    // astSkipped is set when a source file was not parsed because the gate ruled it out.
+    std::vector<Detection> scanFileDetailed(const std::string& filePath, std::uint64_t knownSize,
+                                            bool* astSkipped = nullptr) const;
+    std::vector<Detection> scanBinaryWholeFile(const std::string& filePath, std::uint64_t knownSize) const;
+    std::vector<Detection> scanJarViaMiniZ(const std::string& filePath, const MappedFile& file) const;
+    // false when data is not a zip archive; expanded counts inflated bytes across nesting levels
+    bool scanArchiveBytes(const std::string& displayPath, const unsigned char* archive, std::size_t archiveSize,
+                          std::size_t depth, std::atomic<std::uint64_t>& expanded, std::vector<Detection>& results) const;
+    std::vector<Detection> scanClassFileDetailed(const std::string& filePath, const MappedFile& file) const;
+    // Text patterns over the constant pool strings, OIDs over the raw bytes, then the bytecode
+    // heuristics. byteTypes labels byte matches by pattern type; without it they are labelled "oid".
+    void scanClassData(const std::string& displayPath, const unsigned char* data, std::size_t size,
+                       const std::unordered_map<std::string, std::string>* byteTypes, std::vector<Detection>& out) const;
+    std::vector<Detection> scanCertOrKeyFileDetailed(const std::string& filePath, const MappedFile& file) const;
+    std::vector<Detection> scanBinaryWholeFile(const std::string& filePath, const MappedFile& file) const;
+
+    bool astGateRejects(std::string_view src) const;
+    void matchAstSymbols(const std::string& filePath, const std::vector<AstSymbol>& syms, std::vector<Detection>& out) const;
+    std::uint64_t cacheConfigHash(const ScanOptions& opt) const;
+    void resetRegexBudget();
+    void collectRegexBudget(ScanStats& stats) const;
 
-    std::vector<AlgorithmPattern> patterns;
-    std::vector<BytePattern>      oidBytePatterns;
+    ScanOptions options;
+    // Snapshot of the shared ruleset, taken at construction and again when a
+    // directory scan starts; it stays fixed for the duration of a scan.
+    std::shared_ptr<const Ruleset> rules;
+    // Budget state for rules and options; replaced whenever either is.
+    std::shared_ptr<RegexBudget> regexBudget;
 
     static std::string severityForTextPattern(const std::string& algName, const std::string& matched);
     static std::string severityForByteType(const std::string& type);
     static std::string evidenceTypeForTextPattern(const std::string& algName);
     static std::string evidenceLabelForByteType(const std::string& type);
 
-    static bool isPemText(const std::string& text);
+    static bool isPemText(std::string_view text);
     static std::vector<std::vector<unsigned char>> pemDecodeAll(const std::string& text);
     static std::vector<unsigned char> b64decode(const std::string& s);
 };
@@ -0,0 +1,18 @@
+# Headless scanner: links QtCore only (no QApplication, no widgets).
+# Build it in its own directory so it does not share the GUI's Makefile and objects:
+#   mkdir -p build-cli && cd build-cli && qmake ../CryptoScannerCli.pro && make
+QT = core
+CONFIG += c++17 release console silent object_parallel_to_source no_batch
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = CryptoScannerCli
+
+include(CryptoScannerCore.pri)
+
+SOURCES += \
+    cli_main.cpp \
+    DetectionWriter.cpp
+
+HEADERS += \
+    DetectionWriter.h
@@ -0,0 +1,100 @@
+# Scanner core shared by the GUI (CryptoScanner.pro), the CLI (CryptoScannerCli.pro)
+# and tests/scanner_tests.pro. Files are listed under $$PWD so each of them can include it.
+
+DEFINES += USE_MINIZ
+DEFINES += QT_NO_DEBUG_OUTPUT QT_NO_WARNING_OUTPUT
+DEFINES += MINIZ_NO_ZLIB_APIS MINIZ_NO_ARCHIVE_WRITING_APIS MZ_NO_MESSAGE
+
+INCLUDEPATH += $$PWD
+INCLUDEPATH += $$PWD/third_party/miniz
+INCLUDEPATH += $$PWD/third_party/tree-sitter/lib/include
+
+SOURCES += \
+    $$PWD/CryptoScanner.cpp \
+    $$PWD/FileScanner.cpp \
+    $$PWD/MappedFile.cpp \
+    $$PWD/PatternLoader.cpp \
+    $$PWD/PatternDefinitions.cpp \
+    $$PWD/MultiRegex.cpp \
+    $$PWD/AhoCorasick.cpp \
+    $$PWD/RegexPrefilter.cpp \
+    $$PWD/RegexBudget.cpp \
+    $$PWD/WorkStealingPool.cpp \
+    $$PWD/DirectoryWalker.cpp \
+    $$PWD/AstRuleIndex.cpp \
+    $$PWD/SourceGate.cpp \
+    $$PWD/PatternDb.cpp \
+    $$PWD/Ruleset.cpp \
+    $$PWD/ContentHash.cpp \
+    $$PWD/ScanCache.cpp \
+    $$PWD/ContentDedup.cpp \
+    $$PWD/JavaBytecodeScanner.cpp \
+    $$PWD/JavaASTScanner.cpp \
+    $$PWD/PythonASTScanner.cpp \
+    $$PWD/CppASTScanner.cpp \
+    $$PWD/third_party/miniz/miniz.c \
+    $$PWD/third_party/miniz/miniz_zip.c \
+    $$PWD/third_party/miniz/miniz_tinfl.c \
+    $$PWD/third_party/tree-sitter/lib/src/lib.c \
+    $$PWD/third_party/tree-sitter-cpp/src/parser.c \
+    $$PWD/third_party/tree-sitter-cpp/src/scanner.c \
+    $$PWD/third_party/tree-sitter-java/src/parser.c \
+    $$PWD/third_party/tree-sitter-python/src/parser.c \
+    $$PWD/third_party/tree-sitter-python/src/scanner.c
+
+HEADERS += \
+    $$PWD/CryptoScanner.h \
+    $$PWD/FileScanner.h \
+    $$PWD/MappedFile.h \
+    $$PWD/PatternLoader.h \
+    $$PWD/PatternDefinitions.h \
+    $$PWD/MultiRegex.h \
+    $$PWD/AhoCorasick.h \
+    $$PWD/RegexPrefilter.h \
+    $$PWD/RegexBudget.h \
+    $$PWD/WorkStealingPool.h \
+    $$PWD/DirectoryWalker.h \
+    $$PWD/AstRuleIndex.h \
+    $$PWD/SourceGate.h \
+    $$PWD/PatternDb.h \
+    $$PWD/Ruleset.h \
+    $$PWD/BinaryIO.h \
+    $$PWD/EmbeddedPatterns.h \
+    $$PWD/ContentHash.h \
+    $$PWD/ScanCache.h \
+    $$PWD/ContentDedup.h \
+    $$PWD/JavaBytecodeScanner.h \
+    $$PWD/JavaASTScanner.h \
+    $$PWD/PythonASTScanner.h \
+    $$PWD/CppASTScanner.h
+
+QMAKE_CFLAGS   += -w -D_FILE_OFFSET_BITS=64 -D_LARGEFILE64_SOURCE -fPIC
+QMAKE_CXXFLAGS += -w -fno-diagnostics-show-caret -fno-diagnostics-color -fno-diagnostics-show-option \
+                  -D_FILE_OFFSET_BITS=64 -D_LARGEFILE64_SOURCE -fPIC
+QMAKE_CXXFLAGS += -Wno-unused-function -Wno-misleading-indentation
+
+# patterns.json is compiled into the binary (EmbeddedPatterns.h) and used when neither
+# $CRYPTO_PATTERNS nor ./patterns.json exists. CONFIG+=no_embedded_patterns drops it.
+no_embedded_patterns {
+    DEFINES += CRYPTOSCANNER_NO_EMBEDDED_PATTERNS
+} else {
+    PATTERNDB_GEN_DIR = $$OUT_PWD/tools/patterndb_gen
+    PATTERNDB_GEN = $$PATTERNDB_GEN_DIR/patterndb_gen
+
+    QMAKE_EXTRA_TARGETS += patterndb_gen
+    patterndb_gen.target   = $$PATTERNDB_GEN
+    patterndb_gen.depends  = $$PWD/tools/patterndb_gen/main.cpp $$PWD/PatternLoader.cpp $$PWD/PatternDb.cpp \
+                             $$PWD/AstRuleIndex.cpp $$PWD/MultiRegex.cpp $$PWD/RegexPrefilter.cpp $$PWD/AhoCorasick.cpp
+    patterndb_gen.commands = mkdir -p $$PATTERNDB_GEN_DIR && cd $$PATTERNDB_GEN_DIR && \
+                             $$QMAKE_QMAKE $$PWD/tools/patterndb_gen/patterndb_gen.pro && $(MAKE)
+
+    PATTERNS_JSON = $$PWD/patterns.json
+    embedded_patterns.input         = PATTERNS_JSON
+    embedded_patterns.output        = $$OUT_PWD/EmbeddedPatterns_data.cpp
+    embedded_patterns.commands      = $$PATTERNDB_GEN ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT}
+    embedded_patterns.depends       = $$PATTERNDB_GEN
+    embedded_patterns.variable_out  = SOURCES
+    QMAKE_EXTRA_COMPILERS += embedded_patterns
+}
+
+LIBS += -lssl -lcrypto
@@ -0,0 +1,218 @@
+#include "DetectionWriter.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const char kHex[] = "0123456789abcdef";
+
+// Length of the well-formed UTF-8 sequence at s[i], 0 when there is none.
+std::size_t utf8Length(std::string_view s, std::size_t i){
+    const unsigned char c = s[i];
+    std::size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if(c >= 0xC2 && c <= 0xDF) n = 2;
+    else if(c >= 0xE0 && c <= 0xEF){ n = 3; if(c == 0xE0) lo = 0xA0; else if(c == 0xED) hi = 0x9F; }
+    else if(c >= 0xF0 && c <= 0xF4){ n = 4; if(c == 0xF0) lo = 0x90; else if(c == 0xF4) hi = 0x8F; }
+    else return 0;
+    if(i + n > s.size()) return 0;
+    for(std::size_t k=1; k<n; ++k){
+        const unsigned char b = s[i+k];
+        if(b < (k==1 ? lo : 0x80) || b > (k==1 ? hi : 0xBF)) return 0;
+    }
+    return n;
+}
+
+// Paths and matches are raw bytes; bytes that are not UTF-8 are written as the
+// Latin-1 code point so the output stays valid JSON.
+void appendJson(std::string& o, std::string_view s){
+    o += '"';
+    for(std::size_t i=0; i<s.size(); ){
+        const unsigned char c = s[i];
+        if(c >= 0x80){
+            if(const std::size_t n = utf8Length(s, i)){ o.append(s.data() + i, n); i += n; continue; }
+        }
+        switch(c){
+        case '"':  o += "\\\""; break;
+        case '\\': o += "\\\\"; break;
+        case '\n': o += "\\n";  break;
+        case '\r': o += "\\r";  break;
+        case '\t': o += "\\t";  break;
+        default:
+            if(c < 0x20 || c >= 0x7F){ o += "\\u00"; o += kHex[c >> 4]; o += kHex[c & 15]; }
+            else o += char(c);
+        }
+        ++i;
+    }
+    o += '"';
+}
+
+void appendCsv(std::string& o, std::string_view s){
+    if(s.find_first_of(",\"\r\n") == std::string_view::npos){ o.append(s); return; }
+    o += '"';
+    for(char c: s){ if(c == '"') o += '"'; o += c; }
+    o += '"';
+}
+
+// AST and bytecode detections carry a line number in offset (as in the GUI table).
+bool offsetIsLine(const Detection& d){
+    return d.evidenceType == "ast" || d.evidenceType == "bytecode";
+}
+
+class NdjsonWriter : public DetectionWriter {
+public:
+    explicit NdjsonWriter(std::ostream& out) : out(out) {}
+
+    void write(const Detection& d) override {
+        buf.clear();
+        buf += "{\"file\":";      appendJson(buf, d.filePath);
+        buf += offsetIsLine(d) ? ",\"line\":" : ",\"offset\":";
+        buf += std::to_string(d.offset);
+        buf += ",\"pattern\":";   appendJson(buf, d.algorithm);
+        buf += ",\"match\":";     appendJson(buf, d.matchString);
+        buf += ",\"evidence\":";  appendJson(buf, d.evidenceType);
+        buf += ",\"severity\":";  appendJson(buf, d.severity);
+        buf += "}\n";
+        out.write(buf.data(), buf.size());
+    }
+    void finish(bool) override {}
+
+private:
+    std::ostream& out;
+    std::string buf;
+};
+
+// Same columns and quoting as the GUI's CSV export.
+class CsvWriter : public DetectionWriter {
+public:
+    explicit CsvWriter(std::ostream& out) : out(out) {
+        out << "file,offset_or_line,pattern,match,evidence,severity\n";
+    }
+
+    void write(const Detection& d) override {
+        buf.clear();
+        appendCsv(buf, d.filePath);
+        buf += ',';
+        if(offsetIsLine(d)) buf += "line ";
+        buf += std::to_string(d.offset);
+        buf += ',';  appendCsv(buf, d.algorithm);
+        buf += ',';  appendCsv(buf, d.matchString);
+        buf += ',';  appendCsv(buf, d.evidenceType);
+        buf += ',';  appendCsv(buf, d.severity);
+        buf += '\n';
+        out.write(buf.data(), buf.size());
+    }
+    void finish(bool) override {}
+
+private:
+    std::ostream& out;
+    std::string buf;
+};
+
+// SARIF 2.1.0, one run. Results are written as they arrive; the rules they
+// reference are only known at the end, so "tool" follows "results" in the run
+// object (member order is not significant in JSON).
+class SarifWriter : public DetectionWriter {
+public:
+    explicit SarifWriter(std::ostream& out) : out(out) {
+        out << "{\"version\":\"2.1.0\",\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+               "\"runs\":[{\"results\":[\n";
+    }
+
+    void write(const Detection& d) override {
+        auto it = ruleIndex.find(d.algorithm);
+        if(it == ruleIndex.end()){
+            it = ruleIndex.emplace(d.algorithm, rules.size()).first;
+            rules.push_back(d.algorithm);
+        }
+        buf.clear();
+        if(any) buf += ",\n";
+        any = true;
+        buf += "{\"ruleId\":";         appendJson(buf, d.algorithm);
+        buf += ",\"ruleIndex\":";      buf += std::to_string(it->second);
+        buf += ",\"level\":\"";        buf += level(d.severity);
+        buf += "\",\"message\":{\"text\":";
+        appendJson(buf, d.matchString.empty() ? d.algorithm : d.algorithm + ": " + d.matchString);
+        buf += "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+        appendJson(buf, uri(d.filePath));
+        buf += '}';
+        if(!offsetIsLine(d)){
+            buf += ",\"region\":{\"byteOffset\":";
+            buf += std::to_string(d.offset);
+            buf += '}';
+        }else if(d.offset > 0){
+            buf += ",\"region\":{\"startLine\":";
+            buf += std::to_string(d.offset);
+            buf += '}';
+        }
+        buf += "}}],\"properties\":{\"match\":";
+        appendJson(buf, d.matchString);
+        buf += ",\"evidence\":";  appendJson(buf, d.evidenceType);
+        buf += ",\"severity\":";  appendJson(buf, d.severity);
+        buf += "}}";
+        out.write(buf.data(), buf.size());
+    }
+
+    void finish(bool complete) override {
+        buf.clear();
+        buf += "\n],\"tool\":{\"driver\":{\"name\":\"CryptoScanner\","
+               "\"informationUri\":\"https://github.com/BOB14th-project/CryptoScanner\",\"rules\":[";
+        for(std::size_t i=0; i<rules.size(); ++i){
+            if(i) buf += ',';
+            buf += "{\"id\":";  appendJson(buf, rules[i]);
+            buf += ",\"shortDescription\":{\"text\":";  appendJson(buf, rules[i]);
+            buf += "}}";
+        }
+        buf += "]}},\"invocations\":[{\"executionSuccessful\":";
+        buf += complete ? "true" : "false";
+        buf += "}]}]}\n";
+        out.write(buf.data(), buf.size());
+    }
+
+private:
+    std::ostream& out;
+    std::string buf;
+    bool any = false;
+    std::vector<std::string> rules;
+    std::unordered_map<std::string, std::size_t> ruleIndex;
+
+    static const char* level(const std::string& severity){
+        if(severity == "high") return "error";
+        if(severity == "low")  return "note";
+        return "warning";
+    }
+
+    // Absolute paths become file:// URIs. Archive entries keep their "::" separator;
+    // a relative path whose first segment holds ':' gets "./" so it is not read as a scheme.
+    static std::string uri(const std::string& path){
+        std::string u;
+        if(!path.empty() && path[0] == '/') u = "file://";
+        else if(path.find(':') < path.find('/')) u = "./";
+        for(unsigned char c: path){
+            const bool keep = (c>='A' && c<='Z') || (c>='a' && c<='z') || (c>='0' && c<='9')
+                           || std::string_view("-._~!$&'()*+,;=:@/").find(char(c)) != std::string_view::npos;
+            if(keep) u += char(c);
+            else{ u += '%'; u += "0123456789ABCDEF"[c >> 4]; u += "0123456789ABCDEF"[c & 15]; }
+        }
+        return u;
+    }
+};
+
+}
+
+bool DetectionWriter::parseFormat(const std::string& name, Format& out){
+    if(name == "ndjson" || name == "jsonl"){ out = Format::Ndjson; return true; }
+    if(name == "csv")  { out = Format::Csv;   return true; }
+    if(name == "sarif"){ out = Format::Sarif; return true; }
+    return false;
+}
+
+std::unique_ptr<DetectionWriter> DetectionWriter::create(Format f, std::ostream& out){
+    switch(f){
+    case Format::Csv:   return std::make_unique<CsvWriter>(out);
+    case Format::Sarif: return std::make_unique<SarifWriter>(out);
+    default:            return std::make_unique<NdjsonWriter>(out);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CryptoScanner.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Writes detections to a stream as they are reported, without buffering the scan.
+// write() must not be called concurrently; scanPathLikeAntivirus already
+// serializes onDetect. The constructor writes any header, finish() the trailer.
+class DetectionWriter {
+public:
+    enum class Format { Ndjson, Csv, Sarif };
+
+    virtual ~DetectionWriter() = default;
+    virtual void write(const Detection& d) = 0;
+    // complete is false when the scan was cancelled or a root could not be read.
+    virtual void finish(bool complete) = 0;
+
+    static bool parseFormat(const std::string& name, Format& out);
+    static std::unique_ptr<DetectionWriter> create(Format f, std::ostream& out);
+};
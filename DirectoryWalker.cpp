@@ -0,0 +1,174 @@
+#include "DirectoryWalker.h"
+
+#include "WorkStealingPool.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <memory>
+#include <vector>
+#else
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#endif
+
+#if defined(__linux__)
+
+namespace {
+
+struct LinuxDirent64 {
+    std::uint64_t  d_ino;
+    std::int64_t   d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[1];
+};
+
+constexpr std::size_t kDentBufferSize = 1u << 20;
+
+struct FileInfo {
+    bool ok = false;
+    mode_t mode = 0;
+    std::uint64_t size = 0, dev = 0, ino = 0;
+    std::int64_t mtimeNs = 0;
+
+    DirectoryWalker::Entry entry(std::string path) const { return { std::move(path), size, dev, ino, mtimeNs }; }
+};
+
+FileInfo statAt(int dirFd, const char* name, bool follow){
+    FileInfo fi;
+#ifdef STATX_SIZE
+    struct statx sx{};
+    const int flags = AT_STATX_DONT_SYNC | (follow ? 0 : AT_SYMLINK_NOFOLLOW);
+    if(statx(dirFd, name, flags, STATX_TYPE | STATX_SIZE | STATX_INO | STATX_MTIME, &sx) != 0) return fi;
+    fi.mode    = sx.stx_mode;
+    fi.size    = sx.stx_size;
+    fi.dev     = makedev(sx.stx_dev_major, sx.stx_dev_minor);
+    fi.ino     = sx.stx_ino;
+    fi.mtimeNs = (std::int64_t)sx.stx_mtime.tv_sec * 1000000000 + sx.stx_mtime.tv_nsec;
+#else
+    struct stat st{};
+    if(fstatat(dirFd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) != 0) return fi;
+    fi.mode    = st.st_mode;
+    fi.size    = st.st_size;
+    fi.dev     = st.st_dev;
+    fi.ino     = st.st_ino;
+    fi.mtimeNs = (std::int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    fi.ok = true;
+    return fi;
+}
+
+struct Walk : std::enable_shared_from_this<Walk> {
+    WorkStealingPool& pool;
+    std::function<bool(const std::string&)> skip;
+    std::function<void(DirectoryWalker::Entry&&)> onFile;
+    std::function<bool()> cancelled;
+    bool recurse;
+
+    Walk(WorkStealingPool& p, std::function<bool(const std::string&)> s,
+         std::function<void(DirectoryWalker::Entry&&)> f, std::function<bool()> c, bool r)
+        : pool(p), skip(std::move(s)), onFile(std::move(f)), cancelled(std::move(c)), recurse(r) {}
+
+    void submitDir(std::string dir){
+        pool.submit([self = shared_from_this(), dir = std::move(dir)]{ self->readDir(dir); });
+    }
+
+    void readDir(const std::string& dir){
+        if(cancelled && cancelled()) return;
+        const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(fd < 0) return;
+
+        thread_local std::vector<char> buf(kDentBufferSize);
+        const std::string prefix = (!dir.empty() && dir.back()=='/') ? dir : dir + "/";
+        for(;;){
+            const long n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+            if(n <= 0) break;
+            for(long off=0; off<n; ){
+                const auto* d = reinterpret_cast<const LinuxDirent64*>(buf.data() + off);
+                off += d->d_reclen;
+                const char* name = d->d_name;
+                if(name[0]=='.' && (name[1]=='\0' || (name[1]=='.' && name[2]=='\0'))) continue;
+
+                std::string path = prefix + name;
+                if(skip && skip(path)) continue;
+
+                unsigned char type = d->d_type;
+                if(type == DT_DIR){ if(recurse) submitDir(std::move(path)); continue; }
+                if(type == DT_UNKNOWN){
+                    const FileInfo li = statAt(fd, name, false);
+                    if(!li.ok) continue;
+                    if(S_ISDIR(li.mode)){ if(recurse) submitDir(std::move(path)); continue; }
+                    if(S_ISREG(li.mode)){ onFile(li.entry(std::move(path))); continue; }
+                    if(!S_ISLNK(li.mode)) continue;
+                    type = DT_LNK;
+                }
+                if(type != DT_REG && type != DT_LNK) continue;
+
+                const FileInfo fi = statAt(fd, name, true);
+                if(!fi.ok || !S_ISREG(fi.mode)) continue;
+                onFile(fi.entry(std::move(path)));
+            }
+        }
+        ::close(fd);
+    }
+};
+
+} // namespace
+
+void DirectoryWalker::walk(const std::string& root, WorkStealingPool& pool,
+                           const std::function<bool(const std::string&)>& skip,
+                           const std::function<void(Entry&&)>& onFile,
+                           const std::function<bool()>& cancelled, bool recurse){
+    std::make_shared<Walk>(pool, skip, onFile, cancelled, recurse)->submitDir(root);
+}
+
+bool DirectoryWalker::stat(const std::string& path, Entry& out){
+    const FileInfo fi = statAt(AT_FDCWD, path.c_str(), true);
+    if(!fi.ok || !S_ISREG(fi.mode)) return false;
+    out = fi.entry(path);
+    return true;
+}
+
+#else
+
+namespace fs = std::filesystem;
+
+// Walks synchronously on the calling thread; onFile can still hand work to the pool.
+void DirectoryWalker::walk(const std::string& root, WorkStealingPool&,
+                           const std::function<bool(const std::string&)>& skip,
+                           const std::function<void(Entry&&)>& onFile,
+                           const std::function<bool()>& cancelled, bool recurse){
+    std::error_code ec;
+    for(auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+        !ec && it != fs::recursive_directory_iterator(); it.increment(ec)){
+        if(cancelled && cancelled()) return;
+        const std::string path = it->path().string();
+        if(!recurse) it.disable_recursion_pending();
+        if(skip && skip(path)){ it.disable_recursion_pending(); continue; }
+        std::error_code fec;
+        if(!it->is_regular_file(fec)) continue;
+        const auto size = it->file_size(fec);
+        DirectoryWalker::Entry e{ path, fec ? 0 : (std::uint64_t)size };
+        const auto mtime = it->last_write_time(fec);
+        if(!fec) e.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+        onFile(std::move(e));
+    }
+}
+
+bool DirectoryWalker::stat(const std::string& path, Entry& out){
+    std::error_code ec;
+    if(!fs::is_regular_file(path, ec)) return false;
+    const auto size = fs::file_size(path, ec);
+    out = { path, ec ? 0 : (std::uint64_t)size };
+    const auto mtime = fs::last_write_time(path, ec);
+    if(!ec) out.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return true;
+}
+
+#endif
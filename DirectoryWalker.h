@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class WorkStealingPool;
+
+// Parallel recursive directory walk. On Linux every directory is read with large
+// getdents64 batches on a pool of threads and sizes come from statx; elsewhere it
+// falls back to fs::recursive_directory_iterator. Like that iterator with default
+// options, symlinks are followed to regular files but never descended into.
+class DirectoryWalker {
+public:
+    struct Entry {
+        std::string   path;
+        std::uint64_t size;
+        std::uint64_t dev = 0;
+        std::uint64_t ino = 0;
+        std::int64_t  mtimeNs = 0;
+    };
+
+    // skip(path) is asked for every entry below root; a skipped directory is not read.
+    // onFile receives regular files (and symlinks to them) as soon as they are found and
+    // may submit further work to the same pool. Directory reads are queued on pool and
+    // the call returns at once; pool.wait() marks the end of the walk. All callbacks may
+    // run concurrently and must outlive that wait. Without recurse only root's own
+    // entries are listed.
+    static void walk(const std::string& root, WorkStealingPool& pool,
+                     const std::function<bool(const std::string&)>& skip,
+                     const std::function<void(Entry&&)>& onFile,
+                     const std::function<bool()>& cancelled,
+                     bool recurse = true);
+
+    // Single-path lookup with the same fields as a walk entry; false unless path
+    // is (or links to) a regular file.
+    static bool stat(const std::string& path, Entry& out);
+};
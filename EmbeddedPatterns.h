@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// patterns.json compiled at build time (tools/patterndb_gen) into the pattern
+// database format (PatternDb.h), so the default ruleset is read-only data in the
+// binary. Defined in the generated EmbeddedPatterns_data.cpp; absent when built
+// with CONFIG+=no_embedded_patterns.
+namespace embedded_patterns {
+
+extern const unsigned char kDb[];
+extern const std::size_t   kDbSize;
+extern const std::uint64_t kJsonHash;   // xxh64 of the patterns.json it came from
+
+} // namespace embedded_patterns
@@ -1,14 +1,24 @@
 #include "FileScanner.h"
+#include "MultiRegex.h"
+#include "RegexPrefilter.h"
+#include "RegexBudget.h"
 
 #include <algorithm>
 #include <cctype>
 #include <iomanip>
+#include <istream>
 #include <iterator>
+#include <memory>
 #include <regex>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FILESCANNER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
 namespace {
 
 std::string toHex(const std::vector<uint8_t>& v) {
@@ -38,69 +48,265 @@ bool isLowEntropyPattern(const std::vector<uint8_t>& v){
     return distinct <= 2;
 }
 
-} // namespace
+inline bool isPrintable(unsigned char ch){ return ch>=0x20 && ch<=0x7E; }
 
-std::vector<AsciiString> FileScanner::extractAsciiStrings(const std::vector<unsigned char>& data, std::size_t minLength){
-    std::vector<AsciiString> out;
-    std::string cur;
+// Tracks the run in progress across blocks; bit i of a block mask is set when byte base+i is printable.
+struct RunState {
+    std::size_t minLength;
+    std::vector<PrintableRun>* out;
+    bool inRun = false;
     std::size_t start = 0;
-    for(std::size_t i=0;i<data.size();++i){
-        unsigned char ch=data[i];
-        if(ch>=0x20 && ch<=0x7E){
-            if(cur.empty()) start=i;
-            cur.push_back(static_cast<char>(ch));
+
+    void close(std::size_t end){
+        if(end - start >= minLength) out->push_back({ start, end - start });
+        inRun = false;
+    }
+
+    void block(std::uint64_t mask, std::size_t base){
+        if(inRun && mask==~std::uint64_t(0)) return;
+        if(!inRun && mask==0) return;
+        unsigned pos = 0;
+        while(pos < 64){
+            const std::uint64_t rest = mask >> pos;
+            if(inRun){
+                const std::uint64_t gaps = ~rest;
+                if(gaps==0) return;
+                pos += (unsigned)__builtin_ctzll(gaps);
+                if(pos >= 64) return;
+                close(base + pos);
+            }else{
+                if(rest==0) return;
+                pos += (unsigned)__builtin_ctzll(rest);
+                start = base + pos;
+                inRun = true;
+            }
+        }
+    }
+
+    void scalar(const unsigned char* data, std::size_t from, std::size_t n){
+        for(std::size_t i=from; i<n; ++i){
+            if(isPrintable(data[i])){
+                if(!inRun){ start = i; inRun = true; }
+            }else if(inRun){
+                close(i);
+            }
+        }
+    }
+};
+
+using RunKernel = std::size_t (*)(const unsigned char*, std::size_t, RunState&);
+
+std::size_t runsScalar(const unsigned char*, std::size_t, RunState&){ return 0; }
+
+#ifdef FILESCANNER_X86_SIMD
+// Printable bytes are exactly those with 0x1F < (int8)b < 0x7F.
+__attribute__((target("sse2")))
+std::size_t runsSse2(const unsigned char* data, std::size_t n, RunState& st){
+    const __m128i lo = _mm_set1_epi8(0x1F), hi = _mm_set1_epi8(0x7F);
+    std::size_t i = 0;
+    for(; i + 64 <= n; i += 64){
+        std::uint64_t mask = 0;
+        for(int k=0; k<4; ++k){
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16*k));
+            const __m128i p = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmpgt_epi8(hi, v));
+            mask |= (std::uint64_t)(std::uint32_t)_mm_movemask_epi8(p) << (16*k);
+        }
+        st.block(mask, i);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+std::size_t runsAvx2(const unsigned char* data, std::size_t n, RunState& st){
+    const __m256i lo = _mm256_set1_epi8(0x1F), hi = _mm256_set1_epi8(0x7F);
+    std::size_t i = 0;
+    for(; i + 64 <= n; i += 64){
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        const __m256i pa = _mm256_and_si256(_mm256_cmpgt_epi8(a, lo), _mm256_cmpgt_epi8(hi, a));
+        const __m256i pb = _mm256_and_si256(_mm256_cmpgt_epi8(b, lo), _mm256_cmpgt_epi8(hi, b));
+        const std::uint64_t mask = (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(pa)
+                                 | (std::uint64_t)(std::uint32_t)_mm256_movemask_epi8(pb) << 32;
+        st.block(mask, i);
+    }
+    return i;
+}
+#endif
+
+RunKernel selectRunKernel(){
+#ifdef FILESCANNER_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return runsAvx2;
+    if(__builtin_cpu_supports("sse2")) return runsSse2;
+#endif
+    return runsScalar;
+}
+
+} // namespace
+
+void FileScanner::findPrintableRuns(const unsigned char* data, std::size_t n, std::size_t minLength,
+                                    std::vector<PrintableRun>& out){
+    static const RunKernel kernel = selectRunKernel();
+    RunState st{ std::max<std::size_t>(minLength, 1), &out };
+    const std::size_t done = kernel(data, n, st);
+    st.scalar(data, done, n);
+    if(st.inRun) st.close(n);
+}
+
+BytePatternMatcher::BytePatternMatcher(const std::vector<BytePattern>& patterns){
+    info.reserve(patterns.size());
+    for(std::size_t i=0; i<patterns.size(); ++i){
+        const auto& needle = patterns[i].bytes;
+        Info in{ needle.size(), isLowEntropyPattern(needle), false, 0 };
+        in.allSame = isAllSameByte(needle, in.sameVal);
+        info.push_back(in);
+        longest = std::max(longest, needle.size());
+        ac.add(needle.data(), needle.size(), (std::uint32_t)i);
+    }
+    ac.build();
+}
+
+void BytePatternMatcher::scan(const unsigned char* data, std::size_t n, std::vector<std::vector<std::size_t>>& offsets) const {
+    offsets.assign(info.size(), {});
+    Stream st;
+    feed(st, data, n, offsets);
+}
+
+void BytePatternMatcher::feed(Stream& st, const unsigned char* data, std::size_t n, std::vector<std::vector<std::size_t>>& offsets) const {
+    if(st.nextAllowed.size() != info.size()){
+        st.nextAllowed.assign(info.size(), 0);
+        st.extending.assign(info.size(), 0);
+    }
+    offsets.resize(info.size());
+
+    // all-same-byte skips that reached the end of the previous buffer continue here
+    for(std::size_t id=0; id<info.size(); ++id){
+        if(!st.extending[id]) continue;
+        std::size_t j = 0;
+        while (j < n && data[j] == info[id].sameVal) ++j;
+        st.nextAllowed[id] = st.pos + j;
+        if(j < n) st.extending[id] = 0;
+    }
+
+    ac.scan(data, n, st.state, [&](std::uint32_t id, std::size_t end){
+        const Info& in = info[id];
+        const std::size_t absEnd = st.pos + end;
+        const std::size_t off = absEnd - in.len;
+        if(off < st.nextAllowed[id]) return;
+        offsets[id].push_back(off);
+        if(in.allSame){
+            std::size_t j = end;
+            while (j < n && data[j] == in.sameVal) ++j;
+            st.nextAllowed[id] = st.pos + j;
+            st.extending[id] = (j == n);
+        }else if(in.lowEntropy){
+            st.nextAllowed[id] = absEnd;
         }else{
-            if(cur.size()>=minLength) out.push_back({start, cur});
-            cur.clear();
+            st.nextAllowed[id] = off + 1;
         }
+    });
+    st.pos += n;
+}
+
+std::vector<AsciiString> FileScanner::extractAsciiStrings(const unsigned char* data, std::size_t n, std::size_t minLength){
+    std::vector<PrintableRun> runs;
+    findPrintableRuns(data, n, minLength, runs);
+    std::vector<AsciiString> out;
+    out.reserve(runs.size());
+    for(const auto& r: runs){
+        out.push_back({ r.offset, std::string_view(reinterpret_cast<const char*>(data) + r.offset, r.length) });
     }
-    if(cur.size()>=minLength) out.push_back({start, cur});
     return out;
 }
 
 std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>
-FileScanner::scanStringsWithOffsets(const std::vector<AsciiString>& strings, const std::vector<AlgorithmPattern>& patterns){
+FileScanner::scanStringsWithOffsets(const std::vector<AsciiString>& strings, const std::vector<AlgorithmPattern>& patterns,
+                                    const MultiRegex* engine, const RegexPrefilter* prefilter,
+                                    RegexBudget* budget){
     std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>> res;
-    for(const auto& p: patterns){
-        const std::regex& rx = p.pattern;
+    std::vector<std::vector<std::pair<std::string, std::size_t>>> perPattern(patterns.size());
+
+    const bool useEngine = engine && engine->size()==patterns.size();
+    if(useEngine){
+        std::vector<MultiRegex::Match> ms;
         for(const auto& s: strings){
-            try{
-                std::cregex_iterator it(s.text.c_str(), s.text.c_str()+s.text.size(), rx), end;
-                for(; it!=end; ++it){
-                    auto m = *it;
-                    std::size_t off = s.offset + static_cast<std::size_t>(m.position());
-                    res[p.name].push_back({ m.str(), off });
-                }
-            }catch(const std::regex_error&){ /* ignore malformed regex */ }
+            ms.clear();
+            engine->findAll(s.text.data(), s.text.size(), ms);
+            for(const auto& m: ms){
+                perPattern[m.id].push_back({ std::string(s.text.substr(m.begin, m.end-m.begin)), s.offset + m.begin });
+            }
         }
     }
+
+    std::vector<std::size_t> fallback;
+    for(std::size_t pi=0; pi<patterns.size(); ++pi){
+        if(!(useEngine && engine->supports(pi))) fallback.push_back(pi);
+    }
+    const bool usePrefilter = prefilter && prefilter->size()==patterns.size();
+    std::unique_ptr<RegexBudget> ownBudget;
+    if(!fallback.empty() && !(budget && budget->size()==patterns.size())){
+        ownBudget = std::make_unique<RegexBudget>(patterns.size());
+        budget = ownBudget.get();
+    }
+    std::vector<std::uint8_t> marks;
+    std::vector<RegexBudget::Span> spans;
+    for(const auto& s: strings){
+        if(fallback.empty()) break;
+        if(usePrefilter) prefilter->candidates(s.text.data(), s.text.size(), marks);
+        for(auto pi: fallback){
+            if(usePrefilter && !marks[pi]) continue;
+            spans.clear();
+            budget->find(pi, patterns[pi], useEngine ? engine : nullptr, s.text.data(), s.text.size(), false, spans);
+            for(const auto& sp: spans){
+                perPattern[pi].push_back({ std::string(s.text.substr(sp.begin, sp.end-sp.begin)), s.offset + sp.begin });
+            }
+        }
+    }
+
+    for(std::size_t pi=0; pi<patterns.size(); ++pi){
+        if(perPattern[pi].empty()) continue;
+        auto& dst = res[patterns[pi].name];
+        dst.insert(dst.end(), std::make_move_iterator(perPattern[pi].begin()), std::make_move_iterator(perPattern[pi].end()));
+    }
     return res;
 }
 
 std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>
-FileScanner::scanBytesWithOffsets(const std::vector<unsigned char>& data, const std::vector<BytePattern>& patterns){
+FileScanner::scanBytesWithOffsets(const unsigned char* data, std::size_t n, const std::vector<BytePattern>& patterns,
+                                  const BytePatternMatcher* matcher){
     std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>> res;
 
+    if(matcher && matcher->size()==patterns.size()){
+        std::vector<std::vector<std::size_t>> offsets;
+        matcher->scan(data, n, offsets);
+        for(std::size_t i=0; i<patterns.size(); ++i){
+            if(offsets[i].empty()) continue;
+            const std::string hex = toHex(patterns[i].bytes);
+            auto& dst = res[patterns[i].name];
+            for(auto off: offsets[i]) dst.push_back({ hex, off });
+        }
+        return res;
+    }
+
     for(const auto& p: patterns){
         const auto& needle = p.bytes;
-        if(needle.empty() || data.size() < needle.size()) continue;
+        if(needle.empty() || n < needle.size()) continue;
 
         const bool lowEntropy = isLowEntropyPattern(needle);
         uint8_t sameVal = 0;
         const bool allSame = isAllSameByte(needle, sameVal);
 
         std::size_t pos = 0;
-        while (pos <= data.size() - needle.size()){
-            auto it = std::search(data.begin() + static_cast<std::ptrdiff_t>(pos),
-                                  data.end(), needle.begin(), needle.end());
-            if(it == data.end()) break;
+        while (pos <= n - needle.size()){
+            auto it = std::search(data + pos, data + n, needle.begin(), needle.end());
+            if(it == data + n) break;
 
-            std::size_t off = static_cast<std::size_t>(std::distance(data.begin(), it));
+            std::size_t off = static_cast<std::size_t>(it - data);
             res[p.name].push_back({ toHex(needle), off });
 
             if(allSame){
                 std::size_t j = off + needle.size();
-                while (j < data.size() && data[j] == sameVal) ++j;
+                while (j < n && data[j] == sameVal) ++j;
                 pos = j;
             }else if(lowEntropy){
                 pos = off + needle.size();
@@ -111,4 +317,73 @@ FileScanner::scanBytesWithOffsets(const std::vector<unsigned char>& data, const
     }
     return res;
 }
- 
\ No newline at end of file
+ 
+bool FileScanner::scanStreamWithOffsets(std::istream& in, std::size_t window,
+                                        const std::vector<AlgorithmPattern>& patterns,
+                                        const std::vector<BytePattern>& bytePatterns, const BytePatternMatcher& matcher,
+                                        const MultiRegex* engine, const RegexPrefilter* prefilter, RegexBudget* budget,
+                                        std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>& textOut,
+                                        std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>& byteOut){
+    const std::size_t minLength = 4;
+    window = std::max(window, 4 * kStreamRunOverlap);
+
+    std::vector<unsigned char> buf;
+    std::size_t base = 0;
+    BytePatternMatcher::Stream bst;
+    std::vector<std::vector<std::size_t>> byteOffsets(matcher.size());
+    std::vector<PrintableRun> runs;
+    std::vector<AsciiString> strings;
+    // a run longer than the window is matched in pieces; each piece keeps the matches in
+    // [floor, cutoff) and the next one starts kStreamRunOverlap bytes before cutoff, so
+    // piece edges never decide a kept match
+    std::size_t floor = 0;
+
+    bool last = false;
+    while(!last){
+        const std::size_t carry = buf.size();
+        buf.resize(carry + window);
+        in.read(reinterpret_cast<char*>(buf.data() + carry), (std::streamsize)window);
+        if(in.bad()) return false;
+        const std::size_t got = (std::size_t)in.gcount();
+        buf.resize(carry + got);
+        last = got < window;
+
+        matcher.feed(bst, buf.data() + carry, got, byteOffsets);
+
+        // an unterminated printable tail is kept for the next chunk
+        std::size_t keep = buf.size();
+        if(!last) while(keep > 0 && isPrintable(buf[keep-1])) --keep;
+
+        std::size_t cutoff = static_cast<std::size_t>(-1);
+        strings.clear();
+        if(keep == 0 && !last){
+            keep = buf.size() - 2 * kStreamRunOverlap;
+            cutoff = base + buf.size() - kStreamRunOverlap;
+            strings.push_back({ base, std::string_view(reinterpret_cast<const char*>(buf.data()), buf.size()) });
+        }else{
+            runs.clear();
+            findPrintableRuns(buf.data(), keep, minLength, runs);
+            for(const auto& r: runs){
+                strings.push_back({ base + r.offset, std::string_view(reinterpret_cast<const char*>(buf.data()) + r.offset, r.length) });
+            }
+        }
+
+        auto part = scanStringsWithOffsets(strings, patterns, engine, prefilter, budget);
+        for(auto& alg: part){
+            auto& dst = textOut[alg.first];
+            for(auto& e: alg.second) if(e.second >= floor && e.second < cutoff) dst.push_back(std::move(e));
+        }
+        if(cutoff != static_cast<std::size_t>(-1)) floor = cutoff;
+
+        buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(keep));
+        base += keep;
+    }
+
+    for(std::size_t i=0; i<bytePatterns.size() && i<byteOffsets.size(); ++i){
+        if(byteOffsets[i].empty()) continue;
+        const std::string hex = toHex(bytePatterns[i].bytes);
+        auto& dst = byteOut[bytePatterns[i].name];
+        for(auto off: byteOffsets[i]) dst.push_back({ hex, off });
+    }
+    return true;
+}
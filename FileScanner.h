@@ -1,21 +1,97 @@
 #pragma once
 
 #include "PatternDefinitions.h"
+#include "AhoCorasick.h"
 
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
-struct AsciiString { std::size_t offset; std::string text; };
+// View into the buffer passed to extractAsciiStrings; valid only while that buffer is alive.
+struct AsciiString { std::size_t offset; std::string_view text; };
+struct PrintableRun { std::size_t offset; std::size_t length; };
+
+class MultiRegex;
+class RegexPrefilter;
+class RegexBudget;
+
+// All byte patterns compiled into one automaton; reproduces the per-pattern
+// std::search semantics of FileScanner::scanBytesWithOffsets in a single pass.
+class BytePatternMatcher {
+public:
+    explicit BytePatternMatcher(const std::vector<BytePattern>& patterns);
+
+    // Match state carried between consecutive buffers of one input.
+    struct Stream {
+        std::uint32_t             state = 0;
+        std::size_t               pos = 0;
+        std::vector<std::size_t>  nextAllowed;
+        std::vector<std::uint8_t> extending;
+    };
+
+    std::size_t size() const { return info.size(); }
+    std::size_t maxLength() const { return longest; }
+    void scan(const unsigned char* data, std::size_t n, std::vector<std::vector<std::size_t>>& offsets) const;
+
+    // Feeds the next n bytes of a stream; absolute offsets are appended to offsets (one vector per pattern).
+    void feed(Stream& st, const unsigned char* data, std::size_t n, std::vector<std::vector<std::size_t>>& offsets) const;
+
+private:
+    struct Info {
+        std::size_t len;
+        bool        lowEntropy;
+        bool        allSame;
+        uint8_t     sameVal;
+    };
+    AhoCorasick       ac;
+    std::vector<Info> info;
+    std::size_t       longest = 0;
+};
 
 class FileScanner {
 public:
-    static std::vector<AsciiString> extractAsciiStrings(const std::vector<unsigned char>& data, std::size_t minLength = 4);
+    // Runs of 0x20..0x7E bytes of at least minLength; uses SSE2/AVX2 when the CPU has them.
+    static void findPrintableRuns(const unsigned char* data, std::size_t n, std::size_t minLength,
+                                  std::vector<PrintableRun>& out);
+
+    static std::vector<AsciiString> extractAsciiStrings(const unsigned char* data, std::size_t n, std::size_t minLength = 4);
+    static std::vector<AsciiString> extractAsciiStrings(const std::vector<unsigned char>& data, std::size_t minLength = 4){
+        return extractAsciiStrings(data.data(), data.size(), minLength);
+    }
+    static std::vector<AsciiString> extractAsciiStrings(std::vector<unsigned char>&&, std::size_t = 4) = delete;
+
+    // Patterns the engine does not cover run on std::regex under budget (a default
+    // RegexBudget for this call when null).
+    static std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>
+    scanStringsWithOffsets(const std::vector<AsciiString>& strings, const std::vector<AlgorithmPattern>& patterns,
+                           const MultiRegex* engine = nullptr, const RegexPrefilter* prefilter = nullptr,
+                           RegexBudget* budget = nullptr);
 
     static std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>
-    scanStringsWithOffsets(const std::vector<AsciiString>& strings, const std::vector<AlgorithmPattern>& patterns);
+    scanBytesWithOffsets(const unsigned char* data, std::size_t n, const std::vector<BytePattern>& patterns,
+                         const BytePatternMatcher* matcher = nullptr);
 
     static std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>
-    scanBytesWithOffsets(const std::vector<unsigned char>& data, const std::vector<BytePattern>& patterns);
+    scanBytesWithOffsets(const std::vector<unsigned char>& data, const std::vector<BytePattern>& patterns,
+                         const BytePatternMatcher* matcher = nullptr){
+        return scanBytesWithOffsets(data.data(), data.size(), patterns, matcher);
+    }
+
+    // Chunked equivalent of extractAsciiStrings + scanStringsWithOffsets + scanBytesWithOffsets for
+    // inputs too large to keep in memory; at most about two windows are buffered. Byte matching carries
+    // its automaton state between chunks and printable runs crossing a boundary are carried over, so
+    // offsets equal those of a whole-buffer scan. Runs longer than the window are matched in pieces
+    // overlapping by 2 * kStreamRunOverlap bytes, which is exact for matches shorter than
+    // kStreamRunOverlap. Returns false on a read error.
+    static constexpr std::size_t kStreamRunOverlap = 64 * 1024;
+
+    static bool scanStreamWithOffsets(std::istream& in, std::size_t window,
+                                      const std::vector<AlgorithmPattern>& patterns,
+                                      const std::vector<BytePattern>& bytePatterns, const BytePatternMatcher& matcher,
+                                      const MultiRegex* engine, const RegexPrefilter* prefilter, RegexBudget* budget,
+                                      std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>& textOut,
+                                      std::unordered_map<std::string, std::vector<std::pair<std::string, std::size_t>>>& byteOut);
 };
  
\ No newline at end of file
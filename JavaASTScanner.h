@@ -4,12 +4,13 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace analyzers {
 
 class JavaASTScanner {
 public:
-    static std::vector<AstSymbol> collectSymbols(const std::string& displayPath, const std::string& code);
+    static std::vector<AstSymbol> collectSymbols(std::string_view code);
 };
 
 }
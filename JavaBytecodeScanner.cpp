@@ -1,11 +1,55 @@
 #include "JavaBytecodeScanner.h"
 
 #include <cstdint>
-#include <unordered_set>
 #include <string>
+#include <string_view>
 
 namespace analyzers {
 
+namespace {
+
+enum Marker : std::uint32_t {
+    kMessageDigest = 1u << 0,
+    kCipher        = 1u << 1,
+    kSignature     = 1u << 2,
+    kKeyPairGen    = 1u << 3,
+    kGetInstance   = 1u << 4,
+    kInitialize    = 1u << 5,
+    kDigestAlg     = 1u << 6,
+    kCipherAlg     = 1u << 7,
+    kSignatureAlg  = 1u << 8,
+    kWeakKeySize   = 1u << 9,
+};
+
+struct Needle { std::string_view text; std::uint32_t marker; };
+
+constexpr Needle kNeedles[] = {
+    { "java/security/MessageDigest", kMessageDigest },
+    { "java.security.MessageDigest", kMessageDigest },
+    { "javax/crypto/Cipher", kCipher },
+    { "javax.crypto.Cipher", kCipher },
+    { "java/security/Signature", kSignature },
+    { "java.security.Signature", kSignature },
+    { "java/security/KeyPairGenerator", kKeyPairGen },
+    { "java.security.KeyPairGenerator", kKeyPairGen },
+    { "getInstance", kGetInstance },
+    { "initialize", kInitialize },
+    { "java/security/KeyPairGenerator.initialize", kInitialize },
+    { "MD5", kDigestAlg },
+    { "SHA1", kDigestAlg },
+    { "SHA-1", kDigestAlg },
+    { "DES/ECB", kCipherAlg },
+    { "RC4", kCipherAlg },
+    { "AES/ECB", kCipherAlg },
+    { "MD5withRSA", kSignatureAlg },
+    { "SHA1withRSA", kSignatureAlg },
+    { "SHA-1withRSA", kSignatureAlg },
+};
+
+inline bool printable(unsigned char c){ return c >= 0x20 && c <= 0x7E; }
+
+}
+
 static uint16_t rd16(const unsigned char* p){ return (uint16_t)((p[0]<<8)|p[1]); }
 static uint32_t rd32(const unsigned char* p){ return (uint32_t)((p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3]); }
 
@@ -14,44 +58,46 @@ static void add(std::vector<Detection>& out, const std::string& file, size_t lin
     out.push_back({ file, line, alg, ev, "bytecode", sev });
 }
 
-std::vector<Detection> JavaBytecodeScanner::scanClassBytes(const std::string& displayName,
-                                                           const std::vector<unsigned char>& buf)
+bool JavaBytecodeScanner::parseConstantPool(const unsigned char* buf, std::size_t n, ClassConstants& out,
+                                            std::size_t minLength)
 {
-    std::vector<Detection> out;
-    if(buf.size() < 16) return out;
-    if(rd32(&buf[0]) != 0xCAFEBABE) return out;
+    if(n < 16) return false;
+    if(rd32(buf) != 0xCAFEBABE) return false;
 
     size_t off = 8;
-    if(off+2 > buf.size()) return out;
-    uint16_t cp_count = rd16(&buf[off]); off += 2;
-
-    std::unordered_set<std::string> cp_utf8;
-    std::unordered_set<int32_t> cp_ints;
+    uint16_t cp_count = rd16(buf + off); off += 2;
 
     for(uint16_t i=1; i<cp_count; ++i){
-        if(off >= buf.size()) break;
+        if(off >= n) break;
         uint8_t tag = buf[off++];
 
         switch(tag){
         case 1: {
-            if(off+2 > buf.size()) return out;
-            uint16_t len = rd16(&buf[off]); off+=2;
-            if(off+len > buf.size()) return out;
-            std::string s((const char*)&buf[off], (size_t)len);
+            if(off+2 > n) return false;
+            uint16_t len = rd16(buf + off); off+=2;
+            if(off+len > n) return false;
+            const std::string_view s((const char*)buf + off, len);
+            for(const auto& nd: kNeedles) if(s == nd.text) out.markers |= nd.marker;
+            for(size_t k=0; k<len; ){
+                if(!printable(buf[off+k])){ ++k; continue; }
+                size_t e = k;
+                while(e < len && printable(buf[off+e])) ++e;
+                if(e - k >= minLength) out.strings.push_back({ off + k, s.substr(k, e - k) });
+                k = e;
+            }
             off += len;
-            cp_utf8.insert(s);
             break;
         }
         case 3: {
-            if(off+4 > buf.size()) return out;
-            int32_t v = (int32_t)rd32(&buf[off]); off+=4;
-            cp_ints.insert(v);
+            if(off+4 > n) return false;
+            int32_t v = (int32_t)rd32(buf + off); off+=4;
+            if(v == 512 || v == 768 || v == 1024) out.markers |= kWeakKeySize;
             break;
         }
         case 5:
         case 6:
         {
-            if(off+8 > buf.size()) return out;
+            if(off+8 > n) return false;
             off+=8;
             i++;
             break;
@@ -60,7 +106,7 @@ std::vector<Detection> JavaBytecodeScanner::scanClassBytes(const std::string& di
         case 8:
         case 16:
         {
-            if(off+2 > buf.size()) return out;
+            if(off+2 > n) return false;
             off+=2;
             break;
         }
@@ -70,57 +116,49 @@ std::vector<Detection> JavaBytecodeScanner::scanClassBytes(const std::string& di
         case 12:
         case 18:
         {
-            if(off+4 > buf.size()) return out;
+            if(off+4 > n) return false;
             off+=4;
             break;
         }
         case 15:
         {
-            if(off+3 > buf.size()) return out;
+            if(off+3 > n) return false;
             off+=3;
             break;
         }
         default:
-            return out;
+            return false;
         }
     }
+    return true;
+}
 
-    auto has = [&](const char* s){ return cp_utf8.find(s)!=cp_utf8.end(); };
-    auto hasAlg = [&](std::initializer_list<const char*> alist){
-        for(auto s: alist) if(has(s)) return true;
-        return false;
-    };
+std::vector<Detection> JavaBytecodeScanner::scanConstants(const std::string& displayName, const ClassConstants& cp)
+{
+    std::vector<Detection> out;
+    auto has = [&](std::uint32_t m){ return (cp.markers & m) == m; };
 
-    if( (has("java/security/MessageDigest") || has("java.security.MessageDigest")) &&
-        has("getInstance") &&
-        hasAlg({"MD5","SHA1","SHA-1"}) )
-    {
+    if(has(kMessageDigest | kGetInstance | kDigestAlg)){
         add(out, displayName, 0, "Java: MessageDigest.getInstance(MD5|SHA-1)", "MD5|SHA1", "med");
     }
-
-    if( (has("javax/crypto/Cipher") || has("javax.crypto.Cipher")) &&
-        has("getInstance") &&
-        hasAlg({"DES/ECB","RC4","AES/ECB"}) )
-    {
+    if(has(kCipher | kGetInstance | kCipherAlg)){
         add(out, displayName, 0, "Java: Cipher.getInstance(DES/ECB|RC4|AES/ECB)", "modes", "high");
     }
-
-    if( (has("java/security/Signature") || has("java.security.Signature")) &&
-        has("getInstance") &&
-        hasAlg({"MD5withRSA","SHA1withRSA","SHA-1withRSA"}) )
-    {
+    if(has(kSignature | kGetInstance | kSignatureAlg)){
         add(out, displayName, 0, "Java: Signature.getInstance(MD5withRSA|SHA1withRSA)", "MD5|SHA1", "med");
     }
-
-    if( (has("java/security/KeyPairGenerator") || has("java.security.KeyPairGenerator")) &&
-        ( has("initialize") || has("java/security/KeyPairGenerator.initialize") ) )
-    {
-        if(cp_ints.count(512) || cp_ints.count(768) || cp_ints.count(1024)){
-            add(out, displayName, 0, "Java: KeyPairGenerator.initialize(weak key size)", "512|768|1024", "med");
-        }
+    if(has(kKeyPairGen | kInitialize | kWeakKeySize)){
+        add(out, displayName, 0, "Java: KeyPairGenerator.initialize(weak key size)", "512|768|1024", "med");
     }
-
     return out;
 }
 
+std::vector<Detection> JavaBytecodeScanner::scanClassBytes(const std::string& displayName,
+                                                           const unsigned char* data, std::size_t n)
+{
+    ClassConstants cp;
+    if(!parseConstantPool(data, n, cp)) return {};
+    return scanConstants(displayName, cp);
+}
+
 } // namespace analyzers
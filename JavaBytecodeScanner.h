@@ -8,10 +8,27 @@
 
 namespace analyzers {
 
+// Result of one pass over a class file's constant pool.
+struct ClassConstants {
+    // Printable runs (at least minLength bytes) of the Utf8 entries, as views into the class buffer.
+    std::vector<AsciiString> strings;
+    // Which API / algorithm names and key sizes the bytecode heuristics look for are present.
+    std::uint32_t markers = 0;
+};
+
 class JavaBytecodeScanner {
 public:
+    // false when data is not a well-formed class file; out then holds what was read so far.
+    static bool parseConstantPool(const unsigned char* data, std::size_t n, ClassConstants& out,
+                                  std::size_t minLength = 4);
+    static std::vector<Detection> scanConstants(const std::string& displayName, const ClassConstants& cp);
+
+    static std::vector<Detection> scanClassBytes(const std::string& displayName,
+                                                 const unsigned char* data, std::size_t n);
     static std::vector<Detection> scanClassBytes(const std::string& displayName,
-                                                 const std::vector<unsigned char>& buf);
+                                                 const std::vector<unsigned char>& buf){
+        return scanClassBytes(displayName, buf.data(), buf.size());
+    }
 };
 
 } // namespace analyzers
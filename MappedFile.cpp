@@ -0,0 +1,90 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_POSIX 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+MappedFile::~MappedFile(){ close(); }
+
+MappedFile::MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept {
+    if(this == &o) return *this;
+    close();
+    opened = o.opened;
+    mapped = o.mapped;
+    len    = o.len;
+    heap   = std::move(o.heap);
+    ptr    = mapped ? o.ptr : heap.data();
+    o.opened = false; o.mapped = nullptr; o.ptr = nullptr; o.len = 0;
+    return *this;
+}
+
+void MappedFile::close(){
+#ifdef MAPPEDFILE_POSIX
+    if(mapped) munmap(mapped, len);
+#endif
+    mapped = nullptr;
+    ptr = nullptr;
+    len = 0;
+    heap.clear();
+    heap.shrink_to_fit();
+    opened = false;
+}
+
+#ifdef MAPPEDFILE_POSIX
+bool MappedFile::open(const std::string& path){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return false;
+
+    struct stat st{};
+    if(fstat(fd, &st) != 0){ ::close(fd); return false; }
+
+    if(S_ISREG(st.st_mode) && st.st_size > 0){
+        void* p = mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED){
+            ::close(fd);
+            mapped = p;
+            ptr = static_cast<const unsigned char*>(p);
+            len = (std::size_t)st.st_size;
+            madvise(p, len, MADV_SEQUENTIAL);
+            opened = true;
+            return true;
+        }
+    }
+
+    unsigned char buf[65536];
+    for(;;){
+        ssize_t r = ::read(fd, buf, sizeof(buf));
+        if(r < 0){ ::close(fd); heap.clear(); return false; }
+        if(r == 0) break;
+        heap.insert(heap.end(), buf, buf + r);
+    }
+    ::close(fd);
+    ptr = heap.data();
+    len = heap.size();
+    opened = true;
+    return true;
+}
+#else
+bool MappedFile::open(const std::string& path){
+    close();
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    heap.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    ptr = heap.data();
+    len = heap.size();
+    opened = true;
+    return true;
+}
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file. Regular files are mmap'ed; special files
+// (pipes, character devices, procfs entries reporting size 0) are read into
+// a heap buffer instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path) { open(path); }
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept;
+    MappedFile& operator=(MappedFile&& o) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    bool isMapped() const { return mapped != nullptr; }
+
+    const unsigned char* data() const { return ptr; }
+    std::size_t size() const { return len; }
+    std::string_view view() const { return { reinterpret_cast<const char*>(ptr), len }; }
+
+private:
+    bool opened = false;
+    void* mapped = nullptr;
+    const unsigned char* ptr = nullptr;
+    std::size_t len = 0;
+    std::vector<unsigned char> heap;
+};
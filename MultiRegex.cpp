@@ -0,0 +1,843 @@
+#include "MultiRegex.h"
+#include "BinaryIO.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kMaxProgramSize = 2048;
+constexpr int         kMaxRepeat      = 256;
+// Larger programs are still run by the Pike VM (linear(), findAllOf()), just not in a DFA.
+constexpr std::size_t kMaxLinearProgramSize = 64 * 1024;
+constexpr int         kMaxLinearRepeat      = 8192;
+constexpr std::size_t kMaxDfaStates   = 16384;
+
+struct WordTable {
+    bool v[256];
+    WordTable(){
+        for(int c=0;c<256;++c) v[c] = std::isalnum(c) || c=='_';
+    }
+};
+const WordTable kWord;
+
+inline bool isWordByte(unsigned char c){ return kWord.v[c]; }
+
+struct RxNode {
+    enum Kind { Empty, Set, Cat, Alt, Repeat, Assert } kind = Empty;
+    std::bitset<256> set;
+    std::vector<RxNode> kids;
+    int  min = 0;
+    int  max = -1;
+    bool greedy = true;
+    int  assertKind = 0;
+};
+
+std::bitset<256> rangeSet(int a, int b){
+    std::bitset<256> s;
+    for(int c=a;c<=b;++c) s.set((std::size_t)c);
+    return s;
+}
+
+std::bitset<256> digitSet(){ return rangeSet('0','9'); }
+std::bitset<256> wordSet(){ return rangeSet('0','9') | rangeSet('A','Z') | rangeSet('a','z') | rangeSet('_','_'); }
+std::bitset<256> spaceSet(){ return rangeSet(' ',' ') | rangeSet('\t','\r'); }
+
+std::bitset<256> foldCase(std::bitset<256> s){
+    for(int c='a';c<='z';++c){
+        const int u = c - 'a' + 'A';
+        if(s.test((std::size_t)c) || s.test((std::size_t)u)){ s.set((std::size_t)c); s.set((std::size_t)u); }
+    }
+    return s;
+}
+
+int hexVal(char c){
+    if(c>='0' && c<='9') return c-'0';
+    if(c>='a' && c<='f') return c-'a'+10;
+    if(c>='A' && c<='F') return c-'A'+10;
+    return -1;
+}
+
+class Parser {
+public:
+    Parser(const std::string& pattern, bool icase) : s(pattern), icase(icase) {}
+
+    bool parse(RxNode& out, std::string& why){
+        if(!alternation(out) || i != s.size()){
+            why = err.empty() ? "unexpected ')'" : err;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& s;
+    bool icase;
+    std::size_t i = 0;
+    std::string err;
+
+    bool fail(const char* m){ if(err.empty()) err = m; return false; }
+    bool more() const { return i < s.size(); }
+    char peek() const { return s[i]; }
+
+    RxNode setNode(std::bitset<256> set) const {
+        RxNode n; n.kind = RxNode::Set;
+        n.set = icase ? foldCase(set) : set;
+        return n;
+    }
+
+    bool alternation(RxNode& out){
+        RxNode first;
+        if(!sequence(first)) return false;
+        if(!more() || peek()!='|'){ out = std::move(first); return true; }
+        out = RxNode(); out.kind = RxNode::Alt;
+        out.kids.push_back(std::move(first));
+        while(more() && peek()=='|'){
+            ++i;
+            RxNode alt;
+            if(!sequence(alt)) return false;
+            out.kids.push_back(std::move(alt));
+        }
+        return true;
+    }
+
+    bool sequence(RxNode& out){
+        out = RxNode(); out.kind = RxNode::Cat;
+        while(more() && peek()!='|' && peek()!=')'){
+            RxNode a;
+            if(!quantified(a)) return false;
+            out.kids.push_back(std::move(a));
+        }
+        return true;
+    }
+
+    bool readInt(int& v){
+        std::size_t j = i;
+        v = 0;
+        while(j < s.size() && std::isdigit((unsigned char)s[j])){
+            v = v*10 + (s[j]-'0');
+            if(v > 100000) return fail("repeat count too large");
+            ++j;
+        }
+        if(j==i) return false;
+        i = j;
+        return true;
+    }
+
+    bool quantified(RxNode& out){
+        if(!atom(out)) return false;
+        if(!more()) return true;
+        int mn = 0, mx = -1;
+        char q = peek();
+        if(q=='*'){ mn=0; mx=-1; ++i; }
+        else if(q=='+'){ mn=1; mx=-1; ++i; }
+        else if(q=='?'){ mn=0; mx=1; ++i; }
+        else if(q=='{'){
+            ++i;
+            if(!readInt(mn)) return fail("malformed {n,m}");
+            mx = mn;
+            if(more() && peek()==','){
+                ++i;
+                if(!readInt(mx)) mx = -1;
+            }
+            if(!more() || peek()!='}') return fail("malformed {n,m}");
+            ++i;
+            if(mx>=0 && mx<mn) return fail("bad repeat range");
+        }else{
+            return true;
+        }
+        if(out.kind==RxNode::Assert) return fail("quantified assertion");
+        bool greedy = true;
+        if(more() && peek()=='?'){ greedy = false; ++i; }
+        if(more() && (peek()=='*' || peek()=='+' || peek()=='?' || peek()=='{')) return fail("nested quantifier");
+        RxNode r; r.kind = RxNode::Repeat;
+        r.min = mn; r.max = mx; r.greedy = greedy;
+        r.kids.push_back(std::move(out));
+        out = std::move(r);
+        return true;
+    }
+
+    bool escapeClass(char c, std::bitset<256>& set){
+        switch(c){
+        case 'd': set = digitSet(); return true;
+        case 'D': set = ~digitSet(); return true;
+        case 'w': set = wordSet(); return true;
+        case 'W': set = ~wordSet(); return true;
+        case 's': set = spaceSet(); return true;
+        case 'S': set = ~spaceSet(); return true;
+        default: return false;
+        }
+    }
+
+    bool escapeChar(int& ch){
+        if(!more()) return fail("trailing backslash");
+        char c = s[i++];
+        switch(c){
+        case 'n': ch = '\n'; return true;
+        case 'r': ch = '\r'; return true;
+        case 't': ch = '\t'; return true;
+        case 'f': ch = '\f'; return true;
+        case 'v': ch = '\v'; return true;
+        case '0': ch = 0; return true;
+        case 'x': {
+            if(i+2 > s.size() || hexVal(s[i])<0 || hexVal(s[i+1])<0) return fail("malformed \\x");
+            ch = hexVal(s[i])*16 + hexVal(s[i+1]);
+            i += 2;
+            return true;
+        }
+        case 'u': case 'c': return fail("unsupported escape");
+        default:
+            if(c>='1' && c<='9') return fail("backreference");
+            if(std::isalnum((unsigned char)c)) return fail("unknown escape");
+            ch = (unsigned char)c;
+            return true;
+        }
+    }
+
+    bool bracket(RxNode& out){
+        bool negate = false;
+        if(more() && peek()=='^'){ negate = true; ++i; }
+        std::bitset<256> set;
+        while(true){
+            if(!more()) return fail("unterminated [");
+            char c = peek();
+            if(c==']'){ ++i; break; }
+
+            std::bitset<256> cls;
+            int lo = -1;
+            ++i;
+            if(c=='\\'){
+                if(!more()) return fail("unterminated [");
+                if(escapeClass(peek(), cls)){ ++i; set |= cls; continue; }
+                if(peek()=='b'){ ++i; lo = '\b'; }
+                else if(!escapeChar(lo)) return false;
+            }else{
+                lo = (unsigned char)c;
+            }
+
+            if(i+1 < s.size() && peek()=='-' && s[i+1]!=']'){
+                ++i;
+                int hi = -1;
+                char d = s[i++];
+                if(d=='\\'){
+                    if(!more()) return fail("unterminated [");
+                    if(escapeClass(peek(), cls)) return fail("class in range");
+                    if(peek()=='b'){ ++i; hi = '\b'; }
+                    else if(!escapeChar(hi)) return false;
+                }else{
+                    hi = (unsigned char)d;
+                }
+                if(hi < lo) return fail("bad range");
+                set |= rangeSet(lo, hi);
+            }else{
+                set.set((std::size_t)lo);
+            }
+        }
+        if(icase) set = foldCase(set);
+        out = RxNode(); out.kind = RxNode::Set;
+        out.set = negate ? ~set : set;
+        return true;
+    }
+
+    bool atom(RxNode& out){
+        char c = s[i++];
+        switch(c){
+        case '(': {
+            if(more() && peek()=='?'){
+                if(i+1 < s.size() && s[i+1]==':') i += 2;
+                else return fail("unsupported group");
+            }
+            if(!alternation(out)) return false;
+            if(!more() || peek()!=')') return fail("unterminated (");
+            ++i;
+            return true;
+        }
+        case '[':
+            return bracket(out);
+        case '.': {
+            std::bitset<256> all; all.set();
+            all.reset('\n'); all.reset('\r');
+            out = RxNode(); out.kind = RxNode::Set; out.set = all;
+            return true;
+        }
+        case '^':
+            out = RxNode(); out.kind = RxNode::Assert; out.assertKind = 2;
+            return true;
+        case '$':
+            out = RxNode(); out.kind = RxNode::Assert; out.assertKind = 3;
+            return true;
+        case '*': case '+': case '?':
+            return fail("nothing to repeat");
+        case '\\': {
+            if(!more()) return fail("trailing backslash");
+            char e = peek();
+            if(e=='b' || e=='B'){
+                ++i;
+                out = RxNode(); out.kind = RxNode::Assert; out.assertKind = (e=='b') ? 0 : 1;
+                return true;
+            }
+            std::bitset<256> cls;
+            if(escapeClass(e, cls)){
+                ++i;
+                out = RxNode(); out.kind = RxNode::Set; out.set = cls;
+                return true;
+            }
+            int ch = 0;
+            if(!escapeChar(ch)) return false;
+            out = setNode(rangeSet(ch, ch));
+            return true;
+        }
+        default:
+            out = setNode(rangeSet((unsigned char)c, (unsigned char)c));
+            return true;
+        }
+    }
+};
+
+struct AtomInfo {
+    bool exact = false;
+    std::string lit;
+    std::vector<std::string> atoms;
+};
+
+constexpr std::size_t kMaxAtomAlternatives = 64;
+
+int singleChar(const std::bitset<256>& s){
+    const std::size_t n = s.count();
+    if(n==0 || n>2) return -1;
+    int a = -1, b = -1;
+    for(int c=0;c<256;++c){
+        if(!s.test((std::size_t)c)) continue;
+        if(a<0) a = c; else b = c;
+    }
+    if(n==1) return std::tolower(a);
+    if(std::isalpha(a) && std::tolower(a)==std::tolower(b)) return std::tolower(a);
+    return -1;
+}
+
+std::size_t minLength(const std::vector<std::string>& atoms){
+    std::size_t m = (std::size_t)-1;
+    for(const auto& a: atoms) m = std::min(m, a.size());
+    return atoms.empty() ? 0 : m;
+}
+
+AtomInfo atomsOf(const RxNode& n){
+    AtomInfo r;
+    switch(n.kind){
+    case RxNode::Empty:
+    case RxNode::Assert:
+        r.exact = true;
+        return r;
+    case RxNode::Set: {
+        const int c = singleChar(n.set);
+        if(c>=0){
+            r.exact = true;
+            r.lit.assign(1, (char)c);
+            r.atoms.push_back(r.lit);
+        }
+        return r;
+    }
+    case RxNode::Cat: {
+        std::vector<std::vector<std::string>> cands;
+        std::string run, whole;
+        bool allExact = true;
+        for(const auto& k: n.kids){
+            AtomInfo ai = atomsOf(k);
+            if(ai.exact){
+                run += ai.lit;
+                whole += ai.lit;
+                continue;
+            }
+            allExact = false;
+            if(!run.empty()) cands.push_back({ run });
+            run.clear();
+            if(!ai.atoms.empty()) cands.push_back(std::move(ai.atoms));
+        }
+        if(!run.empty()) cands.push_back({ run });
+        if(allExact){
+            r.exact = true;
+            r.lit = whole;
+            if(!whole.empty()) r.atoms.push_back(whole);
+            return r;
+        }
+        for(auto& c: cands){
+            const std::size_t ml = minLength(c), bl = minLength(r.atoms);
+            if(r.atoms.empty() || ml > bl || (ml==bl && c.size() < r.atoms.size())) r.atoms = std::move(c);
+        }
+        return r;
+    }
+    case RxNode::Alt:
+        for(const auto& k: n.kids){
+            AtomInfo ai = atomsOf(k);
+            if(ai.atoms.empty()) return AtomInfo();
+            r.atoms.insert(r.atoms.end(), ai.atoms.begin(), ai.atoms.end());
+        }
+        if(r.atoms.size() > kMaxAtomAlternatives) r.atoms.clear();
+        return r;
+    case RxNode::Repeat: {
+        if(n.min==0) return r;
+        AtomInfo ai = atomsOf(n.kids.front());
+        if(ai.exact && n.min==n.max && ai.lit.size()*(std::size_t)n.min <= 256){
+            r.exact = true;
+            for(int k=0;k<n.min;++k) r.lit += ai.lit;
+            if(!r.lit.empty()) r.atoms.push_back(r.lit);
+            return r;
+        }
+        r.atoms = std::move(ai.atoms);
+        return r;
+    }
+    }
+    return r;
+}
+
+struct BitsetHash {
+    std::size_t operator()(const std::bitset<256>& b) const { return std::hash<std::bitset<256>>()(b); }
+};
+
+} // namespace
+
+std::shared_ptr<const MultiRegex> MultiRegex::compile(const std::vector<Source>& sources,
+                                                      std::vector<std::string>* unsupportedWhy){
+    auto mr = std::make_shared<MultiRegex>();
+    if(unsupportedWhy) unsupportedWhy->assign(sources.size(), std::string());
+
+    std::unordered_map<std::bitset<256>, std::uint32_t, BitsetHash> setIndex;
+    auto internSet = [&](const std::bitset<256>& b){
+        auto it = setIndex.find(b);
+        if(it != setIndex.end()) return it->second;
+        const std::uint32_t idx = (std::uint32_t)mr->sets.size();
+        mr->sets.push_back(b);
+        setIndex.emplace(b, idx);
+        return idx;
+    };
+
+    std::vector<std::uint32_t> supported;
+    for(std::size_t id=0; id<sources.size(); ++id){
+        Program pr{ (std::uint32_t)mr->prog.size(), (std::uint32_t)mr->prog.size(), npos, 0 };
+
+        RxNode ast;
+        std::string why = "non-ECMAScript syntax";
+        Parser parser(sources[id].pattern, sources[id].icase);
+        if(!sources[id].ecmascript || !parser.parse(ast, why)){
+            if(unsupportedWhy) (*unsupportedWhy)[id] = why;
+            mr->programs.push_back(pr);
+            continue;
+        }
+
+        auto& prog = mr->prog;
+        auto push = [&](Inst in){ prog.push_back(in); return (std::uint32_t)(prog.size()-1); };
+        bool tooBig = false;
+        bool dfaTooBig = false;
+        std::function<std::uint32_t(const RxNode&, std::uint32_t)> emit =
+            [&](const RxNode& n, std::uint32_t next) -> std::uint32_t {
+            if(tooBig) return next;
+            if(prog.size() - pr.begin > kMaxLinearProgramSize){ tooBig = true; return next; }
+            switch(n.kind){
+            case RxNode::Empty:
+                return next;
+            case RxNode::Set:
+                return push({ OpChar, 0, next, internSet(n.set) });
+            case RxNode::Assert:
+                return push({ OpAssert, (std::uint8_t)n.assertKind, next, 0 });
+            case RxNode::Cat:
+                for(std::size_t k=n.kids.size(); k-->0; ) next = emit(n.kids[k], next);
+                return next;
+            case RxNode::Alt: {
+                std::uint32_t alt = emit(n.kids.back(), next);
+                for(std::size_t k=n.kids.size()-1; k-->0; ){
+                    const std::uint32_t pref = emit(n.kids[k], next);
+                    alt = push({ OpSplit, 0, pref, alt });
+                }
+                return alt;
+            }
+            case RxNode::Repeat: {
+                if(n.min > kMaxLinearRepeat || n.max > kMaxLinearRepeat){ tooBig = true; return next; }
+                if(n.min > kMaxRepeat || n.max > kMaxRepeat) dfaTooBig = true;
+                const RxNode& body = n.kids.front();
+                std::uint32_t tail = next;
+                if(n.max < 0){
+                    const std::uint32_t loop = push({ OpSplit, 0, 0, 0 });
+                    const std::uint32_t b = emit(body, loop);
+                    prog[loop] = n.greedy ? Inst{ OpSplit, 0, b, next } : Inst{ OpSplit, 0, next, b };
+                    tail = loop;
+                }else{
+                    for(int k=0; k<n.max-n.min; ++k){
+                        const std::uint32_t b = emit(body, tail);
+                        tail = n.greedy ? push({ OpSplit, 0, b, next }) : push({ OpSplit, 0, next, b });
+                    }
+                }
+                for(int k=0; k<n.min; ++k) tail = emit(body, tail);
+                return tail;
+            }
+            }
+            return next;
+        };
+
+        const std::uint32_t match = push({ OpMatch, 0, (std::uint32_t)id, 0 });
+        const std::uint32_t start = emit(ast, match);
+        if(tooBig){
+            prog.resize(pr.begin);
+            if(unsupportedWhy) (*unsupportedWhy)[id] = "program too large";
+            mr->programs.push_back(pr);
+            continue;
+        }
+        pr.end = (std::uint32_t)prog.size();
+        pr.start = start;
+        if(dfaTooBig || pr.end - pr.begin > kMaxProgramSize){
+            if(unsupportedWhy) (*unsupportedWhy)[id] = "program too large for a DFA";
+            mr->programs.push_back(pr);
+            continue;
+        }
+        pr.inDfa = 1;
+        mr->programs.push_back(pr);
+        supported.push_back((std::uint32_t)id);
+    }
+
+    mr->computeByteClasses();
+    mr->buildDfaGroups(supported, unsupportedWhy);
+    return mr;
+}
+
+std::vector<std::string> MultiRegex::requiredAtoms(const Source& source){
+    RxNode ast;
+    std::string why;
+    Parser parser(source.pattern, source.icase);
+    if(!source.ecmascript || !parser.parse(ast, why)) return {};
+    std::vector<std::string> atoms = atomsOf(ast).atoms;
+    if(minLength(atoms) < 2) return {};
+    std::sort(atoms.begin(), atoms.end());
+    atoms.erase(std::unique(atoms.begin(), atoms.end()), atoms.end());
+    return atoms;
+}
+
+bool MultiRegex::supports(std::size_t id) const {
+    return linear(id) && programs[id].inDfa;
+}
+
+bool MultiRegex::linear(std::size_t id) const {
+    return id < programs.size() && programs[id].start != npos;
+}
+
+void MultiRegex::computeByteClasses(){
+    std::vector<std::bitset<256>> refine = sets;
+    refine.push_back(wordSet());
+    std::uint32_t cls[256] = {};
+    std::uint32_t count = 1;
+    for(const auto& s: refine){
+        std::map<std::pair<std::uint32_t,bool>, std::uint32_t> split;
+        std::uint32_t next = 0;
+        for(int c=0;c<256;++c){
+            auto key = std::make_pair(cls[c], s.test((std::size_t)c));
+            auto it = split.find(key);
+            if(it == split.end()) it = split.emplace(key, next++).first;
+            cls[c] = it->second;
+        }
+        count = next;
+    }
+    for(int c=0;c<256;++c) byteClass[c] = (std::uint8_t)cls[c];
+    numClasses = count;
+}
+
+bool MultiRegex::buildDfa(const std::vector<std::uint32_t>& ids, std::size_t maxStates, Dfa& out) const {
+    std::vector<std::uint32_t> startSet;
+    for(auto id: ids) startSet.push_back(programs[id].start);
+    std::sort(startSet.begin(), startSet.end());
+
+    std::vector<int> classRep(numClasses, -1);
+    for(int c=0;c<256;++c) if(classRep[byteClass[c]] < 0) classRep[byteClass[c]] = c;
+
+    using Key = std::pair<std::uint8_t, std::vector<std::uint32_t>>;
+    std::map<Key, std::uint32_t> index;
+    std::vector<const Key*> states;
+    auto intern = [&](Key&& k) -> std::uint32_t {
+        auto it = index.find(k);
+        if(it != index.end()) return it->second;
+        const std::uint32_t id = (std::uint32_t)states.size();
+        it = index.emplace(std::move(k), id).first;
+        states.push_back(&it->first);
+        return id;
+    };
+
+    std::map<std::vector<std::uint32_t>, std::uint32_t> acceptIndex;
+    out = Dfa();
+    out.acceptSets.push_back({});
+    acceptIndex.emplace(std::vector<std::uint32_t>{}, 0);
+    auto internAccept = [&](std::vector<std::uint32_t>& m) -> std::uint32_t {
+        std::sort(m.begin(), m.end());
+        m.erase(std::unique(m.begin(), m.end()), m.end());
+        auto it = acceptIndex.find(m);
+        if(it != acceptIndex.end()) return it->second;
+        const std::uint32_t id = (std::uint32_t)out.acceptSets.size();
+        out.acceptSets.push_back(m);
+        acceptIndex.emplace(m, id);
+        return id;
+    };
+
+    std::vector<std::uint32_t> seen(prog.size(), npos);
+    std::uint32_t stamp = 0;
+    std::vector<std::uint32_t> stack;
+    // flags: bit0 = previous byte was a word byte, bit1 = at start of input
+    auto closure = [&](const std::vector<std::uint32_t>& kernel, std::uint8_t flags, int next,
+                       std::vector<std::uint32_t>& chars, std::vector<std::uint32_t>& matched){
+        ++stamp;
+        const bool prevWord = flags & 1;
+        const bool atStart  = flags & 2;
+        for(std::size_t k=kernel.size(); k-->0; ) stack.push_back(kernel[k]);
+        while(!stack.empty()){
+            const std::uint32_t pc = stack.back(); stack.pop_back();
+            if(seen[pc]==stamp) continue;
+            seen[pc] = stamp;
+            const Inst& in = prog[pc];
+            switch(in.op){
+            case OpChar:  chars.push_back(pc); break;
+            case OpMatch: matched.push_back(in.x); break;
+            case OpSplit: stack.push_back(in.y); stack.push_back(in.x); break;
+            case OpAssert: {
+                bool ok = false;
+                const bool nextWord = (next==1);
+                switch(in.arg){
+                case AssertWordB:    ok = prevWord != nextWord; break;
+                case AssertNotWordB: ok = prevWord == nextWord; break;
+                case AssertBegin:    ok = atStart; break;
+                case AssertEnd:      ok = (next==2); break;
+                }
+                if(ok) stack.push_back(in.x);
+                break;
+            }
+            }
+        }
+    };
+
+    intern(Key(2, startSet));
+    std::vector<std::uint32_t> chars[3], matched[3], nk;
+    for(std::size_t st=0; st<states.size(); ++st){
+        const std::uint8_t flags = states[st]->first;
+        const std::vector<std::uint32_t> kernel = states[st]->second;
+        for(int nx=0; nx<3; ++nx){
+            chars[nx].clear(); matched[nx].clear();
+            closure(kernel, flags, nx, chars[nx], matched[nx]);
+            out.accept.push_back(internAccept(matched[nx]));
+        }
+        for(std::uint32_t c=0; c<numClasses; ++c){
+            const int rep = classRep[c];
+            const bool w = isWordByte((unsigned char)rep);
+            nk = startSet;
+            for(auto pc: chars[w ? 1 : 0]){
+                if(sets[prog[pc].y].test((std::size_t)rep)) nk.push_back(prog[pc].x);
+            }
+            std::sort(nk.begin(), nk.end());
+            nk.erase(std::unique(nk.begin(), nk.end()), nk.end());
+            out.trans.push_back(intern(Key(w ? 1 : 0, nk)));
+            if(states.size() > maxStates) return false;
+        }
+    }
+    return true;
+}
+
+void MultiRegex::buildDfaGroups(const std::vector<std::uint32_t>& ids, std::vector<std::string>* why){
+    if(ids.empty()) return;
+    Dfa d;
+    if(buildDfa(ids, kMaxDfaStates, d)){
+        dfas.push_back(std::move(d));
+        return;
+    }
+    if(ids.size()==1){
+        programs[ids[0]].inDfa = 0;
+        if(why) (*why)[ids[0]] = "automaton too large";
+        return;
+    }
+    const std::size_t half = ids.size()/2;
+    buildDfaGroups(std::vector<std::uint32_t>(ids.begin(), ids.begin()+half), why);
+    buildDfaGroups(std::vector<std::uint32_t>(ids.begin()+half, ids.end()), why);
+}
+
+bool MultiRegex::pikeSearch(std::size_t id, const char* s, std::size_t n, std::size_t from,
+                            bool anchored, bool notNull, Match& m) const {
+    const Program& P = programs[id];
+    struct Thread { std::uint32_t pc; std::size_t start; };
+    std::vector<Thread> clist, nlist;
+    std::vector<std::size_t> seen(P.end - P.begin, (std::size_t)-1);
+    std::vector<std::uint32_t> stack;
+
+    auto addThread = [&](std::vector<Thread>& list, std::uint32_t pc0, std::size_t start, std::size_t pos){
+        const bool prevWord = pos>0 && isWordByte((unsigned char)s[pos-1]);
+        const bool nextWord = pos<n && isWordByte((unsigned char)s[pos]);
+        stack.push_back(pc0);
+        while(!stack.empty()){
+            const std::uint32_t pc = stack.back(); stack.pop_back();
+            std::size_t& mark = seen[pc - P.begin];
+            if(mark==pos) continue;
+            mark = pos;
+            const Inst& in = prog[pc];
+            switch(in.op){
+            case OpChar:
+            case OpMatch:
+                list.push_back({ pc, start });
+                break;
+            case OpSplit:
+                stack.push_back(in.y); stack.push_back(in.x);
+                break;
+            case OpAssert: {
+                bool ok = false;
+                switch(in.arg){
+                case AssertWordB:    ok = prevWord != nextWord; break;
+                case AssertNotWordB: ok = prevWord == nextWord; break;
+                case AssertBegin:    ok = pos==0; break;
+                case AssertEnd:      ok = pos==n; break;
+                }
+                if(ok) stack.push_back(in.x);
+                break;
+            }
+            }
+        }
+    };
+
+    bool matched = false;
+    for(std::size_t i=from; ; ++i){
+        if(!matched && (!anchored || i==from)) addThread(clist, P.start, i, i);
+        if(clist.empty()){
+            if(matched || anchored || i>=n) break;
+            continue;
+        }
+        nlist.clear();
+        for(const auto& t: clist){
+            const Inst& in = prog[t.pc];
+            if(in.op==OpMatch){
+                if(notNull && t.start==i) continue;
+                matched = true;
+                m = { id, t.start, i };
+                break;
+            }
+            if(i<n && sets[in.y].test((unsigned char)s[i])) addThread(nlist, in.x, t.start, i+1);
+        }
+        clist.swap(nlist);
+        if(i>=n) break;
+    }
+    return matched;
+}
+
+void MultiRegex::save(std::string& out) const {
+    binio::putU32(out, sizeof(Program));
+    binio::putU32(out, sizeof(std::bitset<256>));
+    // field by field: Inst has padding, and the file should not depend on it
+    binio::putU64(out, prog.size());
+    for(const auto& in: prog){
+        binio::putU32(out, (std::uint32_t)in.op | ((std::uint32_t)in.arg << 8));
+        binio::putU32(out, in.x);
+        binio::putU32(out, in.y);
+    }
+    binio::putPod(out, sets);
+    binio::putPod(out, programs);
+    binio::putU32(out, numClasses);
+    out.append(reinterpret_cast<const char*>(byteClass), sizeof byteClass);
+    binio::putU64(out, dfas.size());
+    for(const auto& d: dfas){
+        binio::putPod(out, d.trans);
+        binio::putPod(out, d.accept);
+        binio::putU64(out, d.acceptSets.size());
+        for(const auto& a: d.acceptSets) binio::putPod(out, a);
+    }
+}
+
+std::shared_ptr<const MultiRegex> MultiRegex::load(binio::Reader& r){
+    if(r.u32() != sizeof(Program) || r.u32() != sizeof(std::bitset<256>)) return nullptr;
+    auto mr = std::make_shared<MultiRegex>();
+    const std::uint64_t ni = r.u64();
+    if(ni > (std::uint64_t)(r.end - r.p) / 12) return nullptr;
+    mr->prog.reserve((std::size_t)ni);
+    for(std::uint64_t i=0; i<ni && r.ok; ++i){
+        const std::uint32_t opArg = r.u32();
+        Inst in{ (Op)(opArg & 0xFF), (std::uint8_t)(opArg >> 8), 0, 0 };
+        in.x = r.u32();
+        in.y = r.u32();
+        mr->prog.push_back(in);
+    }
+    r.pod(mr->sets);
+    r.pod(mr->programs);
+    mr->numClasses = r.u32();
+    r.take(mr->byteClass, sizeof mr->byteClass);
+    const std::uint64_t nd = r.u64();
+    for(std::uint64_t i=0; i<nd && r.ok; ++i){
+        Dfa d;
+        r.pod(d.trans);
+        r.pod(d.accept);
+        const std::uint64_t na = r.u64();
+        for(std::uint64_t k=0; k<na && r.ok; ++k){
+            d.acceptSets.emplace_back();
+            r.pod(d.acceptSets.back());
+        }
+        mr->dfas.push_back(std::move(d));
+    }
+    if(!r.ok) return nullptr;
+    return mr;
+}
+
+bool MultiRegex::matchesAny(const char* s, std::size_t n) const {
+    for(const auto& d: dfas){
+        const std::uint32_t* T = d.trans.data();
+        const std::uint32_t* A = d.accept.data();
+        std::uint32_t st = 0;
+        for(std::size_t i=0; i<n; ++i){
+            const unsigned char b = (unsigned char)s[i];
+            if(A[st*3 + (isWordByte(b) ? 1 : 0)]) return true;
+            st = T[st*numClasses + byteClass[b]];
+        }
+        if(A[st*3 + 2]) return true;
+    }
+    return false;
+}
+
+void MultiRegex::findAll(const char* s, std::size_t n, std::vector<Match>& out) const {
+    std::vector<std::uint32_t> hits;
+    for(const auto& d: dfas){
+        const std::uint32_t* T = d.trans.data();
+        const std::uint32_t* A = d.accept.data();
+        std::uint32_t st = 0, lastAcc = 0;
+        for(std::size_t i=0; i<n; ++i){
+            const unsigned char b = (unsigned char)s[i];
+            const std::uint32_t a = A[st*3 + (isWordByte(b) ? 1 : 0)];
+            if(a && a!=lastAcc){
+                hits.insert(hits.end(), d.acceptSets[a].begin(), d.acceptSets[a].end());
+                lastAcc = a;
+            }
+            st = T[st*numClasses + byteClass[b]];
+        }
+        if(const std::uint32_t a = A[st*3 + 2]) hits.insert(hits.end(), d.acceptSets[a].begin(), d.acceptSets[a].end());
+    }
+    if(hits.empty()) return;
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+    for(auto id: hits) findAllOf(id, s, n, out);
+}
+
+bool MultiRegex::findFirst(std::size_t id, const char* s, std::size_t n, Match& m) const {
+    return linear(id) && pikeSearch(id, s, n, 0, false, false, m);
+}
+
+void MultiRegex::findAllOf(std::size_t id, const char* s, std::size_t n, std::vector<Match>& out) const {
+    Match m{};
+    if(!findFirst(id, s, n, m)) return;
+    out.push_back(m);
+    while(true){
+        std::size_t pos;
+        if(m.begin==m.end){
+            if(m.end>=n) break;
+            Match nn{};
+            if(pikeSearch(id, s, n, m.end, true, true, nn)){
+                m = nn;
+                out.push_back(m);
+                continue;
+            }
+            pos = m.end + 1;
+        }else{
+            pos = m.end;
+        }
+        if(!pikeSearch(id, s, n, pos, false, false, m)) break;
+        out.push_back(m);
+    }
+}
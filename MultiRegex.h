@@ -0,0 +1,99 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace binio { struct Reader; }
+
+// Linear-time matcher for the ECMAScript subset used in patterns.json.
+// All supported patterns are compiled into combined DFAs that report which
+// patterns occur in a string in one pass; exact match spans are then produced
+// by a Pike VM with the same leftmost-first semantics as std::regex.
+class MultiRegex {
+public:
+    struct Source {
+        std::string pattern;
+        bool icase = false;
+        bool ecmascript = true;
+    };
+
+    struct Match {
+        std::size_t id;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    static std::shared_ptr<const MultiRegex> compile(const std::vector<Source>& sources,
+                                                     std::vector<std::string>* unsupportedWhy = nullptr);
+
+    // Literals of which at least one must occur (case-insensitively) in any string the
+    // pattern matches. Empty when no literal of two or more bytes is mandatory.
+    static std::vector<std::string> requiredAtoms(const Source& source);
+
+    std::size_t size() const { return programs.size(); }
+    // In a DFA, so findAll() and matchesAny() cover it.
+    bool supports(std::size_t id) const;
+    // Runnable by the Pike VM; also true for programs too large for a DFA.
+    bool linear(std::size_t id) const;
+
+    // Appends every non-overlapping match (std::cregex_iterator semantics) of every
+    // supported pattern, grouped by pattern id in ascending order.
+    void findAll(const char* s, std::size_t n, std::vector<Match>& out) const;
+
+    // One linear() pattern alone on the Pike VM, with std::regex_search and
+    // std::cregex_iterator semantics respectively; no DFA pass.
+    bool findFirst(std::size_t id, const char* s, std::size_t n, Match& m) const;
+    void findAllOf(std::size_t id, const char* s, std::size_t n, std::vector<Match>& out) const;
+
+    // True as soon as one supported pattern occurs in s; runs the DFAs only.
+    bool matchesAny(const char* s, std::size_t n) const;
+
+    // Compiled programs and DFAs, for the pattern database. load() returns null
+    // on malformed input.
+    void save(std::string& out) const;
+    static std::shared_ptr<const MultiRegex> load(binio::Reader& r);
+
+private:
+    enum Op : std::uint8_t { OpChar, OpSplit, OpAssert, OpMatch };
+    enum AssertKind : std::uint8_t { AssertWordB, AssertNotWordB, AssertBegin, AssertEnd };
+
+    struct Inst {
+        Op            op;
+        std::uint8_t  arg;
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+
+    struct Program {
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t start;
+        std::uint32_t inDfa;
+    };
+
+    struct Dfa {
+        std::vector<std::uint32_t> trans;
+        std::vector<std::uint32_t> accept;
+        std::vector<std::vector<std::uint32_t>> acceptSets;
+    };
+
+    static constexpr std::uint32_t npos = 0xFFFFFFFFu;
+
+    std::vector<Inst>             prog;
+    std::vector<std::bitset<256>> sets;
+    std::vector<Program>          programs;
+    std::vector<Dfa>              dfas;
+    std::uint8_t                  byteClass[256] = {};
+    std::uint32_t                 numClasses = 0;
+
+    void computeByteClasses();
+    bool buildDfa(const std::vector<std::uint32_t>& ids, std::size_t maxStates, Dfa& out) const;
+    void buildDfaGroups(const std::vector<std::uint32_t>& ids, std::vector<std::string>* why);
+
+    bool pikeSearch(std::size_t id, const char* s, std::size_t n, std::size_t from,
+                    bool anchored, bool notNull, Match& m) const;
+};
@@ -0,0 +1,171 @@
+#include "PatternDb.h"
+#include "BinaryIO.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "MultiRegex.h"
+#include "RegexPrefilter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+namespace pattern_loader {
+
+namespace {
+
+constexpr char          kMagic[8] = { 'C','S','P','A','T','D','B','\0' };
+constexpr std::uint32_t kFormatVersion = 1;
+// magic, version, json hash, payload hash
+constexpr std::size_t   kHeaderSize = sizeof kMagic + 4 + 8 + 8;
+
+void putRule(std::string& out, const AstRule& r){
+    binio::putStr(out, r.id);
+    binio::putStr(out, r.lang);
+    binio::putStr(out, r.kind);
+    binio::putStr(out, r.callee);
+    binio::putU32(out, (std::uint32_t)r.callees.size());
+    for(const auto& c: r.callees) binio::putStr(out, c);
+    binio::putU32(out, (std::uint32_t)r.arg_index);
+    binio::putStr(out, r.kw);
+    binio::putStr(out, r.kw_value_regex);
+    binio::putStr(out, r.arg_regex);
+    binio::putStr(out, r.message);
+    binio::putStr(out, r.severity);
+}
+
+AstRule readRule(binio::Reader& r){
+    AstRule a;
+    a.id     = r.str();
+    a.lang   = r.str();
+    a.kind   = r.str();
+    a.callee = r.str();
+    const std::uint32_t n = r.u32();
+    for(std::uint32_t i=0; i<n && r.ok; ++i) a.callees.push_back(r.str());
+    a.arg_index      = (int)r.u32();
+    a.kw             = r.str();
+    a.kw_value_regex = r.str();
+    a.arg_regex      = r.str();
+    a.message        = r.str();
+    a.severity       = r.str();
+    return a;
+}
+
+} // namespace
+
+std::string compiledPathFor(const std::string& jsonPath){
+    return jsonPath + ".db";
+}
+
+bool loadCompiled(const std::string& dbPath, std::uint64_t jsonHash, LoadResult& out){
+    MappedFile mf(dbPath);
+    return mf.isOpen() && decodeCompiled(mf.data(), mf.size(), jsonHash, out);
+}
+
+bool decodeCompiled(const unsigned char* data, std::size_t size, std::uint64_t jsonHash, LoadResult& out){
+    if(size < kHeaderSize) return false;
+    binio::Reader r(data, size);
+
+    char magic[sizeof kMagic];
+    r.take(magic, sizeof magic);
+    if(std::memcmp(magic, kMagic, sizeof kMagic) != 0) return false;
+    if(r.u32() != kFormatVersion || r.u64() != jsonHash) return false;
+    const std::uint64_t payloadHash = r.u64();
+    if(content_hash::xxh64(data + kHeaderSize, size - kHeaderSize) != payloadHash) return false;
+
+    LoadResult R;
+    R.sourcePath  = out.sourcePath;
+    R.rulesetHash = jsonHash;
+    R.error       = r.str();
+
+    const std::uint64_t nRegex = r.u64();
+    for(std::uint64_t i=0; i<nRegex && r.ok; ++i){
+        AlgorithmPattern ap;
+        ap.name = r.str();
+        MultiRegex::Source src;
+        src.pattern    = r.str();
+        src.icase      = r.u32() != 0;
+        src.ecmascript = r.u32() != 0;
+        const auto flags = (std::regex_constants::syntax_option_type)r.u32();
+        if(!r.ok) break;
+        // compiled and validated when the database was built
+        ap.pattern = std::make_shared<const LazyRegex>(src.pattern, flags);
+        R.regexPatterns.push_back(std::move(ap));
+        R.regexSources.push_back(std::move(src));
+    }
+
+    const std::uint64_t nBytes = r.u64();
+    for(std::uint64_t i=0; i<nBytes && r.ok; ++i){
+        BytePattern bp;
+        bp.name = r.str();
+        r.pod(bp.bytes);
+        bp.type = r.str();
+        R.bytePatterns.push_back(std::move(bp));
+    }
+
+    const std::uint64_t nRules = r.u64();
+    for(std::uint64_t i=0; i<nRules && r.ok; ++i) R.astRules.push_back(readRule(r));
+
+    if(!r.ok) return false;
+    R.regexEngine    = MultiRegex::load(r);
+    R.regexPrefilter = R.regexEngine ? RegexPrefilter::load(r) : nullptr;
+    if(!r.ok || !R.regexEngine || !R.regexPrefilter) return false;
+
+    out = std::move(R);
+    return true;
+}
+
+std::string serializeCompiled(const LoadResult& in){
+    if(!in.regexEngine || !in.regexPrefilter || in.regexSources.size() != in.regexPatterns.size()) return {};
+
+    std::string payload;
+    binio::putStr(payload, in.error);
+    binio::putU64(payload, in.regexPatterns.size());
+    for(std::size_t i=0; i<in.regexPatterns.size(); ++i){
+        const auto& src = in.regexSources[i];
+        binio::putStr(payload, in.regexPatterns[i].name);
+        binio::putStr(payload, src.pattern);
+        binio::putU32(payload, src.icase ? 1 : 0);
+        binio::putU32(payload, src.ecmascript ? 1 : 0);
+        binio::putU32(payload, (std::uint32_t)in.regexPatterns[i].pattern->flags());
+    }
+    binio::putU64(payload, in.bytePatterns.size());
+    for(const auto& bp: in.bytePatterns){
+        binio::putStr(payload, bp.name);
+        binio::putPod(payload, bp.bytes);
+        binio::putStr(payload, bp.type);
+    }
+    binio::putU64(payload, in.astRules.size());
+    for(const auto& rule: in.astRules) putRule(payload, rule);
+    in.regexEngine->save(payload);
+    in.regexPrefilter->save(payload);
+
+    std::string out;
+    out.append(kMagic, sizeof kMagic);
+    binio::putU32(out, kFormatVersion);
+    binio::putU64(out, in.rulesetHash);
+    binio::putU64(out, content_hash::xxh64(payload.data(), payload.size()));
+    out += payload;
+    return out;
+}
+
+bool saveCompiled(const std::string& dbPath, const LoadResult& in){
+    const std::string out = serializeCompiled(in);
+    if(out.empty()) return false;
+
+    // concurrent scanners may rebuild the same database; each writes its own file
+    const std::string tmp = dbPath + ".tmp." + std::to_string((long)::getpid());
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if(!ofs) return false;
+        ofs.write(out.data(), (std::streamsize)out.size());
+        if(!ofs.flush()) return false;
+    }
+    if(std::rename(tmp.c_str(), dbPath.c_str()) != 0){
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace pattern_loader
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "PatternLoader.h"
+
+#include <cstdint>
+#include <string>
+
+namespace pattern_loader {
+
+// Compiled form of a patterns.json (regex sources and flags, the DFA engine,
+// the prefilter automaton, byte patterns and AST rules), kept next to the JSON
+// as "<json>.db". It is tied to the xxh64 of the JSON bytes, so editing the
+// JSON simply makes the next load rebuild it.
+std::string compiledPathFor(const std::string& jsonPath);
+
+// False when the file is missing, corrupt, from another format version or
+// built from different JSON; out is then left untouched.
+bool loadCompiled(const std::string& dbPath, std::uint64_t jsonHash, LoadResult& out);
+
+// Same for a database already in memory (the embedded default ruleset).
+bool decodeCompiled(const unsigned char* data, std::size_t size, std::uint64_t jsonHash, LoadResult& out);
+
+// The database bytes; empty when in has no compiled engine.
+std::string serializeCompiled(const LoadResult& in);
+
+// Writes to a temporary file and renames it; false when the directory is not writable.
+bool saveCompiled(const std::string& dbPath, const LoadResult& in);
+
+} // namespace pattern_loader
@@ -1,13 +1,35 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <vector>
 #include <cstdint>
 
+// std::regex for one pattern, compiled on first use when loaded from the pattern
+// database: MultiRegex matches most patterns, so many never need it.
+class LazyRegex {
+public:
+    explicit LazyRegex(std::regex compiled) : fl(compiled.flags()), rx(std::move(compiled)) { std::call_once(once, []{}); }
+    LazyRegex(std::string source, std::regex_constants::syntax_option_type flags) : src(std::move(source)), fl(flags) {}
+
+    const std::regex& get() const {
+        std::call_once(once, [this]{ rx = std::regex(src, fl); });
+        return rx;
+    }
+    std::regex_constants::syntax_option_type flags() const { return fl; }
+
+private:
+    std::string src;
+    std::regex_constants::syntax_option_type fl;
+    mutable std::once_flag once;
+    mutable std::regex rx;
+};
+
 struct AlgorithmPattern {
     std::string name;
-    std::regex  pattern;
+    std::shared_ptr<const LazyRegex> pattern;
 };
 
 struct BytePattern {
@@ -1,4 +1,12 @@
 #include "PatternLoader.h"
+#include "AstRuleIndex.h"
+#include "MultiRegex.h"
+#include "RegexPrefilter.h"
+#include "ContentHash.h"
+#include "PatternDb.h"
+#ifndef CRYPTOSCANNER_NO_EMBEDDED_PATTERNS
+#include "EmbeddedPatterns.h"
+#endif
 
 #include <QtCore/QFile>
 #include <QtCore/QJsonArray>
@@ -31,6 +39,16 @@ static bool getBool(const QJsonObject& o, const char* key, bool dflt=false){
     return it->toBool();
 }
 
+static std::string escapeLiteral(const std::string& pat){
+    static const std::string metas = R"(\\.^$|()[]{}*+?!)";
+    std::string esc; esc.reserve(pat.size()*2);
+    for(char ch: pat){
+        if (metas.find(ch) != std::string::npos) esc.push_back('\\');
+        esc.push_back(ch);
+    }
+    return esc;
+}
+
 static std::optional<std::regex> compileRegexSafe(const std::string& pat,
                                                   bool icase,
                                                   bool literal,
@@ -42,16 +60,7 @@ static std::optional<std::regex> compileRegexSafe(const std::string& pat,
     if (syntax == "basic")    flags = std::regex_constants::basic;
     if (icase) flags = static_cast<std::regex_constants::syntax_option_type>(flags | std::regex_constants::icase);
 
-    std::string actual = pat;
-    if (literal) {
-        static const std::string metas = R"(\\.^$|()[]{}*+?!)";
-        std::string esc; esc.reserve(actual.size()*2);
-        for(char ch: actual){
-            if (metas.find(ch) != std::string::npos) esc.push_back('\\');
-            esc.push_back(ch);
-        }
-        actual.swap(esc);
-    }
+    const std::string actual = literal ? escapeLiteral(pat) : pat;
 
     try {
         return std::regex(actual, flags);
@@ -88,37 +97,61 @@ static std::vector<uint8_t> parseHexBytes(const std::string& s){
 
 namespace pattern_loader {
 
-LoadResult loadFromJson(){
-    QString p;
+std::string defaultPath(){
     auto env = QProcessEnvironment::systemEnvironment();
-    if (env.contains("CRYPTO_PATTERNS")) p = env.value("CRYPTO_PATTERNS");
-    else                                 p = "patterns.json";
-    return loadFromJsonFile(p.toStdString());
+    if (env.contains("CRYPTO_PATTERNS")) return qs(env.value("CRYPTO_PATTERNS"));
+    return "patterns.json";
 }
 
-LoadResult loadFromJsonFile(const std::string& path){
+LoadResult loadFromJson(){
+    const std::string path = defaultPath();
+#ifndef CRYPTOSCANNER_NO_EMBEDDED_PATTERNS
+    // an explicit $CRYPTO_PATTERNS is never replaced by the built-in set, even when missing
+    if(!QProcessEnvironment::systemEnvironment().contains("CRYPTO_PATTERNS")
+       && !QFile::exists(QString::fromStdString(path))) return loadEmbedded();
+#endif
+    return loadFromJsonFile(path);
+}
+
+LoadResult loadEmbedded(){
     LoadResult R;
-    R.sourcePath = path;
+    R.sourcePath = "<built-in>";
+#ifndef CRYPTOSCANNER_NO_EMBEDDED_PATTERNS
+    if(!decodeCompiled(embedded_patterns::kDb, embedded_patterns::kDbSize, embedded_patterns::kJsonHash, R)){
+        R.error = "built-in ruleset does not match this build; set CRYPTO_PATTERNS";
+    }
+#else
+    R.error = "built without a built-in ruleset";
+#endif
+    return R;
+}
 
+static bool readJson(const std::string& path, QByteArray& raw, LoadResult& R){
+    R.sourcePath = path;
     QFile f(QString::fromStdString(path));
     if(!f.open(QIODevice::ReadOnly)){
         R.error = "Cannot open " + path;
-        return R;
+        return false;
     }
-    const QByteArray raw = f.readAll();
+    raw = f.readAll();
     f.close();
+    R.rulesetHash = content_hash::xxh64(raw.constData(), (std::size_t)raw.size());
+    return true;
+}
 
+static void compileJson(const QByteArray& raw, LoadResult& R){
     QJsonParseError perr{};
     auto doc = QJsonDocument::fromJson(raw, &perr);
     if (perr.error != QJsonParseError::NoError || !doc.isObject()){
         R.error = std::string("JSON parse error at offset ")
                 + std::to_string(perr.offset) + ": "
                 + qs(perr.errorString());
-        return R;
+        return;
     }
 
     const QJsonObject root = doc.object();
     std::ostringstream warn;
+    std::vector<MultiRegex::Source> engineSources;
 
     if (root.contains("regex") && root["regex"].isArray()){
         for(const auto& v : root["regex"].toArray()){
@@ -138,8 +171,14 @@ LoadResult loadFromJsonFile(const std::string& path){
             if (rx){
                 AlgorithmPattern ap;
                 ap.name    = name;
-                ap.pattern = std::move(*rx);
+                ap.pattern = std::make_shared<const LazyRegex>(std::move(*rx));
                 R.regexPatterns.push_back(std::move(ap));
+
+                MultiRegex::Source src;
+                src.pattern    = literal ? escapeLiteral(pat) : pat;
+                src.icase      = icase;
+                src.ecmascript = (syntax != "extended" && syntax != "basic");
+                engineSources.push_back(std::move(src));
             }else{
                 warn << "[regex] skip '" << name << "': " << why << "\n";
             }
@@ -190,11 +229,37 @@ LoadResult loadFromJsonFile(const std::string& path){
             ar.message        = getString(o, "message", "");
             ar.severity       = getString(o, "severity", "");
 
+            std::string why;
+            if(!analyzers::AstRuleIndex::usable(ar, why)){
+                warn << "[ast_rules] skip '" << ar.id << "': " << why << "\n";
+            }
             R.astRules.push_back(std::move(ar));
         }
     }
 
+    R.regexEngine    = MultiRegex::compile(engineSources);
+    R.regexPrefilter = RegexPrefilter::build(engineSources);
+    R.regexSources   = std::move(engineSources);
+
     R.error = warn.str();
+}
+
+LoadResult loadFromJsonFile(const std::string& path){
+    LoadResult R;
+    QByteArray raw;
+    if(!readJson(path, raw, R)) return R;
+
+    const std::string dbPath = compiledPathFor(path);
+    if(loadCompiled(dbPath, R.rulesetHash, R)) return R;
+    compileJson(raw, R);
+    saveCompiled(dbPath, R);
+    return R;
+}
+
+LoadResult compileJsonFile(const std::string& path){
+    LoadResult R;
+    QByteArray raw;
+    if(readJson(path, raw, R)) compileJson(raw, R);
     return R;
 }
 
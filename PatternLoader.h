@@ -1,11 +1,16 @@
 #pragma once
 
 #include "PatternDefinitions.h"
+#include "MultiRegex.h"
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <regex>
 
+class RegexPrefilter;
+
 namespace pattern_loader {
 
 struct AstRule {
@@ -30,13 +35,30 @@ struct LoadResult {
     std::vector<AlgorithmPattern> regexPatterns;
     std::vector<BytePattern>      bytePatterns;
     std::vector<AstRule>          astRules;
+    // regexPatterns[i] as handed to regexEngine and regexPrefilter
+    std::vector<MultiRegex::Source> regexSources;
+    std::shared_ptr<const MultiRegex> regexEngine;
+    std::shared_ptr<const RegexPrefilter> regexPrefilter;
     std::string                   sourcePath;
     std::string                   error;
+    // xxh64 of the raw JSON bytes; 0 when no file was loaded.
+    std::uint64_t                 rulesetHash = 0;
 };
 
+// $CRYPTO_PATTERNS, or patterns.json in the working directory
+std::string defaultPath();
+
+// defaultPath(); the built-in ruleset when that is patterns.json and there is none
 LoadResult loadFromJson();
 
+// Reuses or refreshes the compiled database next to path.
 LoadResult loadFromJsonFile(const std::string& path);
 
+// Parses and compiles path without touching any database (build tools).
+LoadResult compileJsonFile(const std::string& path);
+
+// The ruleset generated from patterns.json at build time (EmbeddedPatterns.h).
+LoadResult loadEmbedded();
+
 } // namespace pattern_loader
  
\ No newline at end of file
@@ -1,9 +1,9 @@
 #include "PythonASTScanner.h"
 
-#include <fstream>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cctype>
 #include <cstring>
 #include <tree_sitter/api.h>
 
@@ -11,90 +11,153 @@ extern "C" const TSLanguage *tree_sitter_python();
 
 namespace {
 
-std::string read_file(const std::string& path){
-    std::ifstream in(path, std::ios::binary);
-    std::ostringstream ss; ss<<in.rdbuf();
-    return ss.str();
-}
-
-std::string trim(const std::string& s){
+std::string_view trim(std::string_view s){
     size_t i=0,j=s.size();
     while(i<j && std::isspace((unsigned char)s[i]))++i;
     while(j>i && std::isspace((unsigned char)s[j-1]))--j;
     return s.substr(i,j-i);
 }
 
-std::string node_text(TSNode n, const std::string& src){
+std::string_view node_view(TSNode n, std::string_view src){
     uint32_t a=ts_node_start_byte(n), b=ts_node_end_byte(n);
     if(b>src.size()) b=(uint32_t)src.size();
     if(a>b) a=b;
-    return std::string(src.data()+a, src.data()+b);
+    return src.substr(a, b-a);
 }
 
-std::string callee_from_segment(const std::string& seg){
-    auto p = seg.find('(');
-    if(p==std::string::npos) return trim(seg);
-    return trim(seg.substr(0,p));
+// a(x).b(y).name -> name: a receiver that is itself a call is a separate call
+// site, and keeping its text would make chained calls quadratic.
+std::string_view without_call_receiver(std::string_view callee){
+    const auto p = callee.rfind(')');
+    if(p==std::string_view::npos) return callee;
+    callee = trim(callee.substr(p+1));
+    if(!callee.empty() && callee.front()=='.') callee = trim(callee.substr(1));
+    return callee;
 }
 
-std::pair<bool,std::string> first_arg_literal_from_segment(const std::string& seg){
-    auto p = seg.find('(');
-    if(p==std::string::npos) return {false,{}};
-    size_t i=p+1;
-    while(i<seg.size() && std::isspace((unsigned char)seg[i])) ++i;
-    if(i>=seg.size()) return {false,{}};
-    if(seg[i]=='"' || seg[i]=='\''){
-        char q=seg[i++];
-        std::string v;
-        while(i<seg.size()){
-            char c=seg[i++];
-            if(c=='\\' && i<seg.size()){ v.push_back(seg[i++]); continue; }
-            if(c==q) return {true,v};
-            v.push_back(c);
+// First argument as written: the body of a string literal (escapes are left as
+// they are) or the leading identifier of any other expression.
+std::string_view first_arg_view(TSNode args, std::string_view src){
+    if(ts_node_is_null(args)) return {};
+    const uint32_t nc = ts_node_named_child_count(args);
+    for(uint32_t k=0; k<nc; ++k){
+        TSNode a0 = ts_node_named_child(args, k);
+        if(ts_node_is_null(a0) || ts_node_is_extra(a0)) continue;
+        std::string_view t = trim(node_view(a0, src));
+        size_t i=0;
+        while(i<t.size() && i<3 && std::isalpha((unsigned char)t[i])) ++i;
+        if(i<t.size() && (t[i]=='"' || t[i]=='\'')){
+            const char q=t[i++];
+            const size_t b=i;
+            while(i<t.size() && t[i]!=q) i += (t[i]=='\\') ? 2 : 1;
+            return i<t.size() ? t.substr(b, i-b) : std::string_view();
+        }
+        i=0;
+        while(i<t.size() && (std::isalnum((unsigned char)t[i]) || t[i]=='_')) ++i;
+        return t.substr(0, i);
+    }
+    return {};
+}
+
+// Parser reused by every file scanned on the same thread.
+struct ThreadParser {
+    TSParser* parser = ts_parser_new();
+    ThreadParser(){ ts_parser_set_language(parser, tree_sitter_python()); }
+    ~ThreadParser(){ ts_parser_delete(parser); }
+};
+
+// Symbol and field ids of call, looked up once so the walk compares
+// ids instead of node type and field name strings.
+struct CallGrammar {
+    std::vector<bool> isCall;
+    TSFieldId callee = 0, arguments = 0;
+    TSSymbol keywordArgument = 0, listSplat = 0;
+    TSFieldId kwName = 0, kwValue = 0;
+};
+
+const CallGrammar& callGrammar(){
+    static const CallGrammar g = []{
+        CallGrammar cg;
+        const TSLanguage* lang = tree_sitter_python();
+        if(!lang) return cg;
+        cg.isCall.resize(ts_language_symbol_count(lang));
+        for(uint32_t i=0; i<cg.isCall.size(); ++i){
+            const char* name = ts_language_symbol_name(lang, (TSSymbol)i);
+            cg.isCall[i] = name && std::strcmp(name, "call")==0;
+        }
+        cg.callee    = ts_language_field_id_for_name(lang, "function", 8);
+        cg.arguments = ts_language_field_id_for_name(lang, "arguments", 9);
+        cg.keywordArgument = ts_language_symbol_for_name(lang, "keyword_argument", 16, true);
+        cg.listSplat       = ts_language_symbol_for_name(lang, "list_splat", 10, true);
+        cg.kwName  = ts_language_field_id_for_name(lang, "name", 4);
+        cg.kwValue = ts_language_field_id_for_name(lang, "value", 5);
+        return cg;
+    }();
+    return g;
+}
+
+// Positional arguments up to the first *args (after it positions are unknown)
+// and name=value keyword arguments, for rules with arg_index or kw.
+void collect_args(TSNode args, std::string_view src, const CallGrammar& g, AstSymbol& s){
+    if(ts_node_is_null(args)) return;
+    bool positional = true;
+    const uint32_t nc = ts_node_named_child_count(args);
+    for(uint32_t k=0; k<nc; ++k){
+        TSNode a = ts_node_named_child(args, k);
+        if(ts_node_is_null(a) || ts_node_is_extra(a)) continue;
+        const TSSymbol sym = ts_node_symbol(a);
+        if(sym == g.keywordArgument){
+            TSNode name = ts_node_child_by_field_id(a, g.kwName);
+            TSNode value = ts_node_child_by_field_id(a, g.kwValue);
+            if(s.kw_count < AstSymbol::kMaxKeywords && !ts_node_is_null(name) && !ts_node_is_null(value)){
+                s.kw_names[s.kw_count]  = node_view(name, src);
+                s.kw_values[s.kw_count] = ast_arg_value(trim(node_view(value, src)));
+                ++s.kw_count;
+            }
+        }else if(sym == g.listSplat){
+            positional = false;
+        }else if(positional && s.arg_count < AstSymbol::kMaxArgs){
+            s.args[s.arg_count++] = ast_arg_value(trim(node_view(a, src)));
         }
-        return {false,{}};
     }
-    size_t j=i;
-    while(j<seg.size() && (std::isalnum((unsigned char)seg[j]) || seg[j]=='_')) ++j;
-    if(j>i) return {true, seg.substr(i, j-i)};
-    return {false,{}};
 }
 
 }
 
 namespace analyzers {
 
-std::vector<AstSymbol> PythonASTScanner::collectSymbols(const std::string& path){
+std::vector<AstSymbol> PythonASTScanner::collectSymbols(std::string_view code){
     std::vector<AstSymbol> out;
-    std::string code = read_file(path);
     if(code.empty()) return out;
 
-    TSParser* parser = ts_parser_new();
-    ts_parser_set_language(parser, tree_sitter_python());
-    TSTree* tree = ts_parser_parse_string(parser, nullptr, code.c_str(), (uint32_t)code.size());
-    if(!tree){ ts_parser_delete(parser); return out; }
+    const CallGrammar& grammar = callGrammar();
+    thread_local ThreadParser tp;
+    TSTree* tree = ts_parser_parse_string(tp.parser, nullptr, code.data(), (uint32_t)code.size());
+    if(!tree){ ts_parser_reset(tp.parser); return out; }
 
     TSNode root = ts_tree_root_node(tree);
     std::vector<TSNode> stack; stack.push_back(root);
 
     while(!stack.empty()){
         TSNode n = stack.back(); stack.pop_back();
-        const char* t = ts_node_type(n);
-
-        if(std::strcmp(t,"call")==0){
-            std::string seg = node_text(n, code);
-            std::string callee = callee_from_segment(seg);
-            auto ar = first_arg_literal_from_segment(seg);
-            TSPoint p = ts_node_start_point(n);
-            size_t line = (size_t)p.row + 1;
-            AstSymbol s;
-            s.filePath = path;
-            s.line = line;
-            s.lang = "python";
-            s.callee_full = callee;
-            s.callee_base = callee;
-            s.first_arg = ar.first ? ar.second : std::string();
-            out.push_back(std::move(s));
+        const TSSymbol sym = ts_node_symbol(n);
+
+        if(sym < grammar.isCall.size() && grammar.isCall[sym]){
+            TSNode fn = ts_node_child_by_field_id(n, grammar.callee);
+            TSNode args = ts_node_child_by_field_id(n, grammar.arguments);
+            if(!ts_node_is_null(fn)){
+                const std::string_view callee = without_call_receiver(trim(node_view(fn, code)));
+                if(!callee.empty()){
+                    AstSymbol s;
+                    s.line = (size_t)ts_node_start_point(n).row + 1;
+                    s.lang = "python";
+                    s.callee_full = callee;
+                    s.callee_base = callee;
+                    s.first_arg = first_arg_view(args, code);
+                    collect_args(args, code, grammar, s);
+                    out.push_back(s);
+                }
+            }
         }
 
         uint32_t c = ts_node_child_count(n);
@@ -107,7 +170,6 @@ std::vector<AstSymbol> PythonASTScanner::collectSymbols(const std::string& path)
     }
 
     ts_tree_delete(tree);
-    ts_parser_delete(parser);
     return out;
 }
 
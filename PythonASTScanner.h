@@ -4,12 +4,13 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 
 namespace analyzers {
 
 class PythonASTScanner {
 public:
-    static std::vector<AstSymbol> collectSymbols(const std::string& path);
+    static std::vector<AstSymbol> collectSymbols(std::string_view code);
 };
 
 }
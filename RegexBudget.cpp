@@ -0,0 +1,93 @@
+#include "RegexBudget.h"
+#include "MultiRegex.h"
+
+#include <algorithm>
+
+RegexBudget::RegexBudget(std::size_t patterns, std::size_t maxInput, unsigned budgetMs)
+    : maxInput(std::max<std::size_t>(maxInput, 2)),
+      budget(std::chrono::milliseconds(budgetMs)),
+      counts(patterns), linearOnly(patterns), pieceLen(patterns) {
+    for(auto& p: pieceLen) p.store(this->maxInput, std::memory_order_relaxed);
+}
+
+void RegexBudget::findLinear(std::size_t id, const MultiRegex& engine, const char* s, std::size_t n,
+                             std::size_t from, bool firstOnly, std::vector<Span>& out) const {
+    MultiRegex::Match m{};
+    if(firstOnly && from == 0){
+        if(engine.findFirst(id, s, n, m)) out.push_back({ m.begin, m.end });
+        return;
+    }
+    std::vector<MultiRegex::Match> ms;
+    engine.findAllOf(id, s, n, ms);
+    for(const auto& x: ms){
+        if(x.begin < from) continue;
+        out.push_back({ x.begin, x.end });
+        if(firstOnly) return;
+    }
+}
+
+void RegexBudget::find(std::size_t id, const AlgorithmPattern& ap, const MultiRegex* engine,
+                       const char* s, std::size_t n, bool firstOnly, std::vector<Span>& out){
+    if(id >= counts.size()) return;
+    const bool linear = engine && engine->linear(id);
+    std::size_t piece = pieceLen[id].load(std::memory_order_relaxed);
+    if(!piece){
+        counts[id].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // one count per call, however many ways it exceeds
+    bool counted = n > maxInput;
+    if(counted) counts[id].fetch_add(1, std::memory_order_relaxed);
+    if(linear && (n > maxInput || linearOnly[id].load(std::memory_order_relaxed))){
+        findLinear(id, *engine, s, n, 0, firstOnly, out);
+        return;
+    }
+
+    // the piece at from covers [from, from + piece) and keeps the matches starting
+    // before from + piece/2; piece only shrinks, so consecutive pieces still overlap
+    std::size_t resume = 0;
+    for(std::size_t from = 0; ; ){
+        const std::size_t step = piece / 2;
+        const std::size_t len = std::min(n - from, piece);
+        const bool last = from + len == n;
+        const std::size_t keepEnd = last ? n + 1 : from + step;
+        const auto flags = from ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+        bool found = false, failed = false;
+
+        const auto t0 = std::chrono::steady_clock::now();
+        try{
+            std::cregex_iterator it(s + from, s + from + len, ap.pattern->get(), flags), end;
+            for(; it!=end; ++it){
+                const std::size_t b = from + (std::size_t)it->position();
+                if(b >= keepEnd) break;
+                if(b < resume) continue;
+                resume = b + (std::size_t)it->length();
+                out.push_back({ b, resume });
+                if(firstOnly){ found = true; break; }
+            }
+        }catch(const std::regex_error&){ failed = true; }
+
+        if(failed || (budget.count() > 0 && std::chrono::steady_clock::now() - t0 > budget)){
+            if(!counted) counts[id].fetch_add(1, std::memory_order_relaxed);
+            counted = true;
+            if(linear){
+                linearOnly[id].store(true, std::memory_order_relaxed);
+                // a piece that threw stopped somewhere after resume; one that was only
+                // slow has all its matches before keepEnd
+                if(!found && (failed || !last)){
+                    findLinear(id, *engine, s, n, failed ? resume : std::max(resume, keepEnd), firstOnly, out);
+                }
+                return;
+            }
+            std::size_t expected = piece;
+            pieceLen[id].compare_exchange_strong(expected, piece / 2 >= kMinPiece ? piece / 2 : 0,
+                                                 std::memory_order_relaxed);
+            piece = pieceLen[id].load(std::memory_order_relaxed);
+            if(!piece) return;
+            // a piece that threw is run again, shorter; resume drops what it already reported
+            if(failed) continue;
+        }
+        if(found || last) return;
+        from += step;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "PatternDefinitions.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class MultiRegex;
+
+// Limits on the std::regex calls that remain: patterns MultiRegex keeps out of its
+// DFAs and the AST fallback over call sites. libstdc++ backtracks with no step limit
+// and recurses once per input byte, overflowing a thread stack near 32 KiB.
+//  - No std::regex pass sees more than maxInput bytes. A longer input goes to the
+//    Pike VM when the pattern has a program there, else to std::regex in pieces
+//    overlapping by half a piece, which is exact for matches shorter than that.
+//  - std::regex cannot be interrupted, so a pass is timed once it returns and
+//    budgetMs does not bound any one call; it decides what a pattern does after a
+//    slow (or throwing) pass. With a Pike program it runs there for the rest of the
+//    scan. Without one its pieces are halved, down to kMinPiece bytes, and a pattern
+//    still too slow at that size is skipped for the rest of the scan.
+// Every call that exceeds a limit or is skipped counts once, per pattern. One
+// instance per ruleset snapshot, shared by all workers; all members are thread-safe.
+class RegexBudget {
+public:
+    struct Span { std::size_t begin, end; };
+
+    explicit RegexBudget(std::size_t patterns, std::size_t maxInput = 8 * 1024, unsigned budgetMs = 20);
+
+    // Matches of ap (pattern id of engine, which may be null) in [s, s+n) with
+    // std::cregex_iterator semantics; only the first when firstOnly.
+    void find(std::size_t id, const AlgorithmPattern& ap, const MultiRegex* engine,
+              const char* s, std::size_t n, bool firstOnly, std::vector<Span>& out);
+
+    std::size_t   size() const { return counts.size(); }
+    std::uint64_t exceeded(std::size_t id) const { return counts[id].load(std::memory_order_relaxed); }
+    bool          demoted(std::size_t id) const { return linearOnly[id].load(std::memory_order_relaxed); }
+    bool          skipped(std::size_t id) const { return pieceLen[id].load(std::memory_order_relaxed) == 0; }
+
+private:
+    static constexpr std::size_t kMinPiece = 256;
+
+    std::size_t maxInput;
+    std::chrono::steady_clock::duration budget;
+    std::vector<std::atomic<std::uint64_t>> counts;
+    std::vector<std::atomic<bool>>          linearOnly;
+    // std::regex piece length per pattern; 0 once it is skipped
+    std::vector<std::atomic<std::size_t>>   pieceLen;
+
+    void findLinear(std::size_t id, const MultiRegex& engine, const char* s, std::size_t n,
+                    std::size_t from, bool firstOnly, std::vector<Span>& out) const;
+};
@@ -0,0 +1,69 @@
+#include "RegexPrefilter.h"
+#include "BinaryIO.h"
+
+#include <cctype>
+#include <unordered_map>
+
+std::shared_ptr<const RegexPrefilter> RegexPrefilter::build(const std::vector<MultiRegex::Source>& sources){
+    auto pf = std::make_shared<RegexPrefilter>();
+    std::unordered_map<std::string, std::uint32_t> atomIndex;
+    for(std::size_t id=0; id<sources.size(); ++id){
+        pf->patternAtoms.push_back(MultiRegex::requiredAtoms(sources[id]));
+        if(pf->patternAtoms.back().empty()){
+            pf->always.push_back((std::uint32_t)id);
+            continue;
+        }
+        for(const auto& a: pf->patternAtoms.back()){
+            std::string key; key.reserve(a.size());
+            for(unsigned char c: a) key.push_back((char)std::tolower(c));
+            auto it = atomIndex.find(key);
+            if(it == atomIndex.end()){
+                it = atomIndex.emplace(key, (std::uint32_t)pf->atomOwners.size()).first;
+                pf->atomOwners.emplace_back();
+                pf->ac.add(key, it->second);
+            }
+            pf->atomOwners[it->second].push_back((std::uint32_t)id);
+        }
+    }
+    pf->ac.build();
+    return pf;
+}
+
+void RegexPrefilter::candidates(const char* s, std::size_t n, std::vector<std::uint8_t>& marks) const {
+    marks.assign(patternAtoms.size(), 0);
+    for(auto id: always) marks[id] = 1;
+    ac.scan(reinterpret_cast<const unsigned char*>(s), n, [&](std::uint32_t atom, std::size_t){
+        for(auto id: atomOwners[atom]) marks[id] = 1;
+    });
+}
+
+void RegexPrefilter::save(std::string& out) const {
+    ac.save(out);
+    binio::putU64(out, patternAtoms.size());
+    for(const auto& atoms: patternAtoms){
+        binio::putU32(out, (std::uint32_t)atoms.size());
+        for(const auto& a: atoms) binio::putStr(out, a);
+    }
+    binio::putU64(out, atomOwners.size());
+    for(const auto& o: atomOwners) binio::putPod(out, o);
+    binio::putPod(out, always);
+}
+
+std::shared_ptr<const RegexPrefilter> RegexPrefilter::load(binio::Reader& r){
+    auto pf = std::make_shared<RegexPrefilter>();
+    pf->ac.load(r);
+    const std::uint64_t np = r.u64();
+    for(std::uint64_t i=0; i<np && r.ok; ++i){
+        pf->patternAtoms.emplace_back();
+        const std::uint32_t na = r.u32();
+        for(std::uint32_t k=0; k<na && r.ok; ++k) pf->patternAtoms.back().push_back(r.str());
+    }
+    const std::uint64_t no = r.u64();
+    for(std::uint64_t i=0; i<no && r.ok; ++i){
+        pf->atomOwners.emplace_back();
+        r.pod(pf->atomOwners.back());
+    }
+    r.pod(pf->always);
+    if(!r.ok) return nullptr;
+    return pf;
+}
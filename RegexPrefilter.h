@@ -0,0 +1,37 @@
+#pragma once
+
+#include "AhoCorasick.h"
+#include "MultiRegex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace binio { struct Reader; }
+
+// One Aho-Corasick pass over a string tells which regex patterns can possibly match it:
+// a pattern is a candidate when one of its required literal atoms occurs, or always
+// when no atom could be extracted from it.
+class RegexPrefilter {
+public:
+    static std::shared_ptr<const RegexPrefilter> build(const std::vector<MultiRegex::Source>& sources);
+
+    std::size_t size() const { return patternAtoms.size(); }
+    bool unconditional(std::size_t id) const { return patternAtoms[id].empty(); }
+    const std::vector<std::string>& atoms(std::size_t id) const { return patternAtoms[id]; }
+
+    // Resizes marks to size() and sets marks[id] for every candidate pattern.
+    void candidates(const char* s, std::size_t n, std::vector<std::uint8_t>& marks) const;
+
+    // For the pattern database; load() returns null on malformed input.
+    void save(std::string& out) const;
+    static std::shared_ptr<const RegexPrefilter> load(binio::Reader& r);
+
+private:
+    AhoCorasick ac{ true };
+    std::vector<std::vector<std::string>>   patternAtoms;
+    std::vector<std::vector<std::uint32_t>> atomOwners;
+    std::vector<std::uint32_t>              always;
+};
@@ -0,0 +1,86 @@
+#include "Ruleset.h"
+#include "AstRuleIndex.h"
+#include "DirectoryWalker.h"
+#include "FileScanner.h"
+#include "MultiRegex.h"
+#include "RegexPrefilter.h"
+#include "SourceGate.h"
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+// Published with std::atomic_load/atomic_store; builders serialize on reloadMutex.
+std::shared_ptr<const Ruleset> published;
+std::mutex reloadMutex;
+
+void statSource(Ruleset& rs){
+    DirectoryWalker::Entry e;
+    if(DirectoryWalker::stat(rs.sourcePath, e)){
+        rs.fileSize    = e.size;
+        rs.fileMtimeNs = e.mtimeNs;
+    }
+}
+
+} // namespace
+
+std::shared_ptr<const Ruleset> Ruleset::build(pattern_loader::LoadResult&& LR){
+    if(!LR.error.empty()){
+        std::cerr << "[CryptoScanner] Warning: failed to load patterns.json: " << LR.error << "\n";
+    }
+    auto rs = std::make_shared<Ruleset>();
+    rs->patterns        = std::move(LR.regexPatterns);
+    rs->oidBytePatterns = std::move(LR.bytePatterns);
+    for(const auto& bp: rs->oidBytePatterns) rs->byteTypes[bp.name] = bp.type;
+    rs->regexEngine     = LR.regexEngine;
+    rs->regexPrefilter  = LR.regexPrefilter;
+    rs->byteMatcher     = std::make_shared<const BytePatternMatcher>(rs->oidBytePatterns);
+    rs->astRules        = std::make_shared<const analyzers::AstRuleIndex>(
+                              LR.astRules.empty() ? crypto_patterns::getDefaultASTRules() : LR.astRules);
+    rs->astGate         = std::make_shared<const SourceGate>(
+                              std::vector<std::string>(rs->astRules->callees().begin(), rs->astRules->callees().end()),
+                              rs->regexEngine, rs->regexPrefilter.get(), LR.regexSources);
+    rs->sourcePath      = LR.sourcePath;
+    rs->hash            = LR.rulesetHash;
+    statSource(*rs);
+    return rs;
+}
+
+std::shared_ptr<const Ruleset> Ruleset::current(){
+    if(auto rs = std::atomic_load(&published)) return rs;
+    std::lock_guard<std::mutex> lk(reloadMutex);
+    if(auto rs = std::atomic_load(&published)) return rs;
+    auto rs = build(pattern_loader::loadFromJson());
+    std::atomic_store(&published, rs);
+    return rs;
+}
+
+std::shared_ptr<const Ruleset> Ruleset::refresh(){
+    auto cur = current();
+    const std::string path = pattern_loader::defaultPath();
+    DirectoryWalker::Entry e;
+    // no file (yet): keep what we have, including the built-in ruleset
+    if(!DirectoryWalker::stat(path, e)) return cur;
+    if(path == cur->sourcePath && e.size == cur->fileSize && e.mtimeNs == cur->fileMtimeNs) return cur;
+
+    std::lock_guard<std::mutex> lk(reloadMutex);
+    cur = std::atomic_load(&published);
+    auto LR = pattern_loader::loadFromJsonFile(path);
+    if(LR.rulesetHash == 0) return cur;   // unreadable right now; keep what we have
+    if(path == cur->sourcePath && LR.rulesetHash == cur->hash){
+        // touched but unchanged: remember the new stat so the next check is cheap again
+        auto same = std::make_shared<Ruleset>(*cur);
+        statSource(*same);
+        std::atomic_store(&published, std::shared_ptr<const Ruleset>(same));
+        return same;
+    }
+    if(LR.regexPatterns.empty() && LR.bytePatterns.empty() && LR.astRules.empty()){
+        std::cerr << "[CryptoScanner] Warning: keeping previous rules, " << path << " did not load: " << LR.error << "\n";
+        return cur;
+    }
+    auto next = build(std::move(LR));
+    std::atomic_store(&published, next);
+    return next;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PatternDefinitions.h"
+#include "PatternLoader.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MultiRegex;
+class RegexPrefilter;
+class BytePatternMatcher;
+class SourceGate;
+namespace analyzers { class AstRuleIndex; }
+
+// Everything compiled from one patterns.json. Never modified after build(), so
+// every scanner and worker thread shares one instance through
+// shared_ptr<const Ruleset>.
+struct Ruleset {
+    std::vector<AlgorithmPattern> patterns;
+    std::vector<BytePattern>      oidBytePatterns;
+    // oidBytePatterns name -> type, for labelling byte matches inside archives
+    std::unordered_map<std::string, std::string> byteTypes;
+    std::shared_ptr<const MultiRegex>              regexEngine;
+    std::shared_ptr<const RegexPrefilter>          regexPrefilter;
+    std::shared_ptr<const BytePatternMatcher>      byteMatcher;
+    std::shared_ptr<const analyzers::AstRuleIndex> astRules;
+    std::shared_ptr<const SourceGate>              astGate;
+
+    std::string   sourcePath;    // "<built-in>" for the embedded ruleset
+    std::uint64_t hash = 0;      // xxh64 of the JSON, 0 when none was loaded
+    std::uint64_t fileSize = 0;  // JSON size and mtime when it was read
+    std::int64_t  fileMtimeNs = 0;
+
+    static std::shared_ptr<const Ruleset> build(pattern_loader::LoadResult&& LR);
+
+    // The process-wide ruleset (loaded on first use). Readers take a snapshot and
+    // keep it for as long as they need; nothing they hold ever changes.
+    static std::shared_ptr<const Ruleset> current();
+
+    // Re-reads the JSON when it appears or its size or mtime changed and, if its contents differ,
+    // builds a new ruleset and swaps it in. Scans holding the previous snapshot
+    // finish on it; the old ruleset is freed with its last holder. A JSON that no
+    // longer loads keeps the previous ruleset. Returns the (possibly new) current one.
+    static std::shared_ptr<const Ruleset> refresh();
+};
@@ -0,0 +1,132 @@
+#include "ScanCache.h"
+#include "MappedFile.h"
+#include "BinaryIO.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+constexpr char          kMagic[8] = { 'C','S','C','A','C','H','E','\0' };
+constexpr std::uint32_t kFormatVersion = 2;
+
+} // namespace
+
+ScanCache::ScanCache(std::string cacheFile, std::uint64_t configHash)
+    : file(std::move(cacheFile)), config(configHash) {}
+
+void ScanCache::load(){
+    records.clear();
+    MappedFile mf(file);
+    if(!mf.isOpen()) return;
+    binio::Reader r(mf.data(), mf.size());
+
+    char magic[sizeof kMagic];
+    if(!r.take(magic, sizeof magic) || std::memcmp(magic, kMagic, sizeof kMagic) != 0) return;
+    if(r.u32() != kFormatVersion || r.u64() != config || !r.ok) return;
+
+    std::unordered_map<std::string, Record> loaded;
+    const std::uint64_t count = r.u64();
+    for(std::uint64_t i=0; i<count && r.ok; ++i){
+        std::string path = r.str();
+        Record rec;
+        rec.size    = r.u64();
+        rec.dev     = r.u64();
+        rec.ino     = r.u64();
+        rec.mtimeNs = (std::int64_t)r.u64();
+        const std::uint32_t n = r.u32();
+        for(std::uint32_t k=0; k<n && r.ok; ++k){
+            Stored s;
+            s.relative     = r.u32() != 0;
+            s.path         = r.str();
+            s.offset       = r.u64();
+            s.algorithm    = r.str();
+            s.matchString  = r.str();
+            s.evidenceType = r.str();
+            s.severity     = r.str();
+            rec.detections.push_back(std::move(s));
+        }
+        loaded.emplace(std::move(path), std::move(rec));
+    }
+    if(r.ok) records = std::move(loaded);
+}
+
+bool ScanCache::save(const std::function<bool(const std::string&)>& walked) const {
+    std::string out;
+    out.append(kMagic, sizeof kMagic);
+    binio::putU32(out, kFormatVersion);
+    binio::putU64(out, config);
+    {
+        std::lock_guard<std::mutex> lk(m);
+        auto keep = [&](const std::pair<const std::string, Record>& kv){
+            return kv.second.used || !walked || !walked(kv.first);
+        };
+        std::uint64_t count = 0;
+        for(const auto& kv: records) if(keep(kv)) ++count;
+        binio::putU64(out, count);
+        for(const auto& kv: records){
+            if(!keep(kv)) continue;
+            const Record& rec = kv.second;
+            binio::putStr(out, kv.first);
+            binio::putU64(out, rec.size);
+            binio::putU64(out, rec.dev);
+            binio::putU64(out, rec.ino);
+            binio::putU64(out, (std::uint64_t)rec.mtimeNs);
+            binio::putU32(out, (std::uint32_t)rec.detections.size());
+            for(const auto& s: rec.detections){
+                binio::putU32(out, s.relative ? 1 : 0);
+                binio::putStr(out, s.path);
+                binio::putU64(out, s.offset);
+                binio::putStr(out, s.algorithm);
+                binio::putStr(out, s.matchString);
+                binio::putStr(out, s.evidenceType);
+                binio::putStr(out, s.severity);
+            }
+        }
+    }
+
+    const std::string tmp = file + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if(!ofs) return false;
+        ofs.write(out.data(), (std::streamsize)out.size());
+        if(!ofs.flush()) return false;
+    }
+    if(std::rename(tmp.c_str(), file.c_str()) != 0){
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ScanCache::lookup(const DirectoryWalker::Entry& e, std::vector<Detection>& out) const {
+    std::lock_guard<std::mutex> lk(m);
+    auto it = records.find(e.path);
+    if(it == records.end()) return false;
+    const Record& rec = it->second;
+    rec.used = true;
+    if(rec.size != e.size || rec.dev != e.dev || rec.ino != e.ino || rec.mtimeNs != e.mtimeNs) return false;
+    for(const auto& s: rec.detections){
+        out.push_back({ s.relative ? e.path + s.path : s.path, (std::size_t)s.offset,
+                        s.algorithm, s.matchString, s.evidenceType, s.severity });
+    }
+    return true;
+}
+
+void ScanCache::store(const DirectoryWalker::Entry& e, const std::vector<Detection>& detections){
+    Record rec{ e.size, e.dev, e.ino, e.mtimeNs, {}, true };
+    rec.detections.reserve(detections.size());
+    for(const auto& d: detections){
+        const bool relative = d.filePath.compare(0, e.path.size(), e.path) == 0;
+        rec.detections.push_back({ relative, relative ? d.filePath.substr(e.path.size()) : d.filePath,
+                                   (std::uint64_t)d.offset, d.algorithm, d.matchString, d.evidenceType, d.severity });
+    }
+    std::lock_guard<std::mutex> lk(m);
+    records[e.path] = std::move(rec);
+}
+
+std::size_t ScanCache::size() const {
+    std::lock_guard<std::mutex> lk(m);
+    return records.size();
+}
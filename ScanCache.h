@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CryptoScanner.h"
+#include "DirectoryWalker.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// On-disk record of per-file detections from earlier scans. A file's entry is
+// reused only while its device, inode, size and mtime are unchanged, and the
+// whole cache is dropped when it was written under a different configuration
+// hash (ruleset contents and options that change results).
+// Entries under the walked root that were not looked up or stored since load()
+// are stale (deleted, renamed or excluded) and are left out when a complete run
+// saves; entries of other roots sharing the file are kept.
+// lookup() may run concurrently with store(); load() and save() may not.
+class ScanCache {
+public:
+    ScanCache(std::string cacheFile, std::uint64_t configHash);
+
+    // A missing, corrupt or stale cache file leaves the cache empty.
+    void load();
+    // Writes to a temporary file and renames it over the cache file. Unused entries
+    // for which walked(path) holds are left out; without walked all are written.
+    bool save(const std::function<bool(const std::string&)>& walked = nullptr) const;
+
+    // On a hit, appends the cached detections, re-rooted at e.path, to out.
+    bool lookup(const DirectoryWalker::Entry& e, std::vector<Detection>& out) const;
+    void store(const DirectoryWalker::Entry& e, const std::vector<Detection>& detections);
+
+    std::size_t size() const;
+
+private:
+    struct Stored {
+        // Detection paths are kept relative to the scanned file ("" or "::entry");
+        // anything else is stored verbatim.
+        bool          relative;
+        std::string   path;
+        std::uint64_t offset;
+        std::string   algorithm;
+        std::string   matchString;
+        std::string   evidenceType;
+        std::string   severity;
+    };
+    struct Record {
+        std::uint64_t size, dev, ino;
+        std::int64_t  mtimeNs;
+        std::vector<Stored> detections;
+        mutable bool  used = false;
+    };
+
+    std::string   file;
+    std::uint64_t config;
+    mutable std::mutex m;
+    std::unordered_map<std::string, Record> records;
+};
@@ -0,0 +1,63 @@
+#include "SourceGate.h"
+#include "RegexPrefilter.h"
+
+namespace {
+
+// A rule matches when its whole name equals the callee or its trailing
+// components, so each component of the name occurs in the source as one
+// identifier even when the qualified name does not ("hashlib . md5"). The
+// longest one is the most selective.
+std::string longestComponent(const std::string& name){
+    std::size_t best = 0, bestLen = 0;
+    for(std::size_t i=0; i<name.size(); ){
+        std::size_t j = i;
+        while(j<name.size() && name[j]!='.' && name[j]!=':' && name[j]!='-' && name[j]!='>') ++j;
+        if(j-i > bestLen){ best = i; bestLen = j-i; }
+        i = j + 1;
+    }
+    return name.substr(best, bestLen);
+}
+
+// ^, $ and lookarounds can match a callee or argument without matching the
+// same text inside the whole file.
+bool positionSensitive(const std::string& pattern){
+    return pattern.find_first_of("^$") != std::string::npos
+        || pattern.find("(?=") != std::string::npos
+        || pattern.find("(?!") != std::string::npos;
+}
+
+}
+
+SourceGate::SourceGate(const std::vector<std::string>& calleeNames,
+                       std::shared_ptr<const MultiRegex> eng,
+                       const RegexPrefilter* prefilter,
+                       const std::vector<MultiRegex::Source>& sources){
+    std::uint32_t id = 0;
+    for(const auto& n: calleeNames){
+        const std::string part = longestComponent(n);
+        if(part.empty()) continue;
+        callees.add(part, id);
+        calleesAndAtoms.add(part, id++);
+    }
+
+    if(!eng || eng->size() != sources.size() || !prefilter || prefilter->size() != sources.size()){
+        patternsAlways = true;
+    }else{
+        engine = std::move(eng);
+        for(std::size_t i=0; i<sources.size(); ++i){
+            if(engine->supports(i) && !positionSensitive(sources[i].pattern)) continue;
+            if(prefilter->unconditional(i)){ patternsAlways = true; break; }
+            for(const auto& a: prefilter->atoms(i)) calleesAndAtoms.add(a, id++);
+        }
+    }
+
+    callees.build();
+    calleesAndAtoms.build();
+}
+
+bool SourceGate::mayMatch(std::string_view src, bool withPatterns) const {
+    const auto* data = reinterpret_cast<const unsigned char*>(src.data());
+    if(!withPatterns) return callees.any(data, src.size());
+    if(patternsAlways || calleesAndAtoms.any(data, src.size())) return true;
+    return engine && engine->matchesAny(src.data(), src.size());
+}
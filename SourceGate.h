@@ -0,0 +1,34 @@
+#pragma once
+
+#include "AhoCorasick.h"
+#include "MultiRegex.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class RegexPrefilter;
+
+// Literal pre-scan that decides whether a source file is worth parsing. Every
+// AST detection comes from a callee or first argument, and both are substrings
+// of the source, so a file can be skipped when none of the rule callee names
+// occurs in it and, with the regex fallback, no pattern matches anywhere in it.
+// Patterns the DFA engine cannot run are represented by their required atoms.
+class SourceGate {
+public:
+    // engine and prefilter must be built from sources (same ids); without them
+    // patterns never rule a file out.
+    SourceGate(const std::vector<std::string>& calleeNames,
+               std::shared_ptr<const MultiRegex> engine,
+               const RegexPrefilter* prefilter,
+               const std::vector<MultiRegex::Source>& sources);
+
+    bool mayMatch(std::string_view src, bool withPatterns) const;
+
+private:
+    AhoCorasick callees{ true };
+    AhoCorasick calleesAndAtoms{ true };
+    std::shared_ptr<const MultiRegex> engine;
+    bool patternsAlways = false;
+};
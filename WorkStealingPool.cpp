@@ -0,0 +1,159 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace {
+thread_local WorkStealingPool* tlsPool = nullptr;
+thread_local std::size_t tlsIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t threads){
+    threads = std::max<std::size_t>(threads, 1);
+    for(std::size_t i=0; i<threads; ++i) queues.push_back(std::make_unique<Queue>());
+    for(std::size_t i=0; i<threads; ++i) workers.emplace_back([this, i]{ run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    cancel();
+    {
+        std::lock_guard<std::mutex> lk(m);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for(auto& t: workers) t.join();
+}
+
+WorkStealingPool* WorkStealingPool::current(){
+    return tlsPool;
+}
+
+std::size_t WorkStealingPool::defaultThreads(){
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+void WorkStealingPool::submit(std::function<void()> task){
+    const std::size_t q = (tlsPool == this) ? tlsIndex : nextQueue.fetch_add(1) % queues.size();
+    {
+        std::lock_guard<std::mutex> lk(m);
+        ++queued;
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> lk(queues[q]->m);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+bool WorkStealingPool::take(std::size_t self, std::function<void()>& task){
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lk(own.m);
+        if(!own.tasks.empty()){
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for(std::size_t k=1; k<queues.size(); ++k){
+        Queue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard<std::mutex> lk(victim.m);
+        if(!victim.tasks.empty()){
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(std::size_t self){
+    tlsPool = this;
+    tlsIndex = self;
+    for(;;){
+        {
+            std::unique_lock<std::mutex> lk(m);
+            workAvailable.wait(lk, [&]{ return stopping || queued > 0; });
+            if(stopping && queued == 0) return;
+        }
+        std::function<void()> task;
+        if(!take(self, task)) continue;
+        {
+            std::lock_guard<std::mutex> lk(m);
+            --queued;
+        }
+        try{
+            task();
+        }catch(...){
+            std::lock_guard<std::mutex> lk(m);
+            if(!firstError) firstError = std::current_exception();
+        }
+        finished(1);
+    }
+}
+
+void WorkStealingPool::finished(std::size_t n){
+    std::lock_guard<std::mutex> lk(m);
+    pending -= n;
+    if(pending == 0) allDone.notify_all();
+}
+
+void WorkStealingPool::cancel(){
+    std::size_t dropped = 0;
+    for(auto& q: queues){
+        std::lock_guard<std::mutex> lk(q->m);
+        dropped += q->tasks.size();
+        q->tasks.clear();
+    }
+    if(dropped == 0) return;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        queued -= dropped;
+    }
+    finished(dropped);
+}
+
+void WorkStealingPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& body){
+    if(n == 0) return;
+    // helpers may start after this call has returned; they only touch the shared
+    // counters then, which make them exit at once
+    struct State {
+        std::function<void(std::size_t)> body;
+        std::size_t n;
+        std::atomic<std::size_t> next{0};
+        std::size_t done = 0;
+        std::mutex m;
+        std::condition_variable cv;
+        std::exception_ptr error;
+    };
+    auto st = std::make_shared<State>();
+    st->body = body;
+    st->n = n;
+    auto drain = [st]{
+        for(std::size_t i = st->next.fetch_add(1); i < st->n; i = st->next.fetch_add(1)){
+            std::exception_ptr err;
+            try{ st->body(i); }catch(...){ err = std::current_exception(); }
+            std::lock_guard<std::mutex> lk(st->m);
+            if(err && !st->error) st->error = err;
+            if(++st->done == st->n) st->cv.notify_all();
+        }
+    };
+    const std::size_t helpers = std::min(workers.size(), n) - 1;
+    for(std::size_t k=0; k<helpers; ++k) submit(drain);
+    drain();
+
+    std::unique_lock<std::mutex> lk(st->m);
+    st->cv.wait(lk, [&]{ return st->done == st->n; });
+    if(st->error) std::rethrow_exception(st->error);
+}
+
+void WorkStealingPool::wait(){
+    std::unique_lock<std::mutex> lk(m);
+    allDone.wait(lk, [&]{ return pending == 0; });
+    if(firstError){
+        std::exception_ptr e = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(e);
+    }
+}
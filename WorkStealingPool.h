@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with one deque per worker. A worker runs its own newest
+// task first and steals the oldest task of another worker when its deque is empty.
+// Exceptions thrown by tasks are kept and the first one is rethrown from wait().
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(std::size_t threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t size() const { return workers.size(); }
+
+    // Safe from any thread, including from inside a running task.
+    void submit(std::function<void()> task);
+
+    // Drops queued tasks; tasks that are already running finish normally.
+    void cancel();
+
+    // Blocks until every submitted task has finished or been dropped.
+    void wait();
+
+    // Runs body(0..n-1) on the calling thread and on idle workers; returns when all
+    // n calls are done and rethrows the first exception among them. Unlike wait()
+    // it is safe from inside a task, because the caller works off the indices
+    // itself instead of waiting for queued helpers.
+    void parallelFor(std::size_t n, const std::function<void(std::size_t)>& body);
+
+    // The pool whose worker is running the calling thread, or nullptr.
+    static WorkStealingPool* current();
+
+    static std::size_t defaultThreads();
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex              m;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::size_t             queued = 0;
+    std::size_t             pending = 0;
+    bool                    stopping = false;
+    std::atomic<std::size_t> nextQueue{0};
+    std::exception_ptr      firstError;
+
+    bool take(std::size_t self, std::function<void()>& task);
+    void run(std::size_t self);
+    void finished(std::size_t n);
+};
@@ -0,0 +1,19 @@
+QT -= gui core
+CONFIG += c++17 release console silent object_parallel_to_source
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = extract_strings_bench
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    extract_strings_bench.cpp \
+    ../FileScanner.cpp \
+    ../MultiRegex.cpp \
+    ../AhoCorasick.cpp \
+    ../RegexPrefilter.cpp \
+    ../RegexBudget.cpp
+
+HEADERS += \
+    ../FileScanner.h
@@ -0,0 +1,265 @@
+#include "AstRuleIndex.h"
+#include "CryptoScanner.h"
+#include "DetectionWriter.h"
+#include "Ruleset.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// 1..3 is the highest severity found at or above --fail-on (low, med, high).
+enum Exit { kClean = 0, kError = 4, kUsage = 64 };
+
+std::atomic<int> gSignal{0};
+
+void onSignal(int sig){ gSignal.store(sig); }
+
+int severityRank(const std::string& s){
+    if(s == "high") return 3;
+    if(s == "med")  return 2;
+    return 1;
+}
+
+// Decimal count with an optional binary K/M/G suffix.
+bool parseSize(const std::string& s, std::uint64_t& out){
+    if(s.empty()) return false;
+    std::size_t pos = 0;
+    unsigned long long v;
+    try{ v = std::stoull(s, &pos, 10); }catch(...){ return false; }
+    if(s[0] == '-') return false;
+    const std::string unit = s.substr(pos);
+    int shift = 0;
+    if(unit == "K" || unit == "k") shift = 10;
+    else if(unit == "M" || unit == "m") shift = 20;
+    else if(unit == "G" || unit == "g") shift = 30;
+    else if(!unit.empty()) return false;
+    if(shift && v > (~0ull >> shift)) return false;
+    out = v << shift;
+    return true;
+}
+
+void usage(std::ostream& os){
+    const ScanOptions d;
+    os << "Usage: CryptoScannerCli [options] <path>...\n"
+          "Scans files, directories and archives and streams detections while the scan runs.\n"
+          "\n"
+          "Output:\n"
+          "  -f, --format ndjson|csv|sarif  output format (default ndjson)\n"
+          "  -o, --output FILE              write to FILE instead of stdout\n"
+          "      --fail-on high|med|low|none\n"
+          "                                 lowest severity that makes the exit status non-zero (default low)\n"
+          "      --patterns FILE            rules file (default $CRYPTO_PATTERNS, ./patterns.json, built-in)\n"
+          "      --progress                 report progress on stderr once a second\n"
+          "      --stats                    print scan statistics on stderr\n"
+          "\n"
+          "Scan options (sizes take a K, M or G suffix):\n"
+          "      --no-recurse               do not descend into subdirectories\n"
+          "      --no-deep-jar              scan JAR/ZIP/WAR/EAR archives as plain binaries, without opening them\n"
+          "      --stream-threshold SIZE    scan binaries of at least SIZE in windows (" << d.streamThreshold << ")\n"
+          "      --stream-window SIZE       window size for streamed binaries (" << d.streamWindow << ")\n"
+          "  -j, --threads N                worker threads, 0 = one per hardware thread (" << d.threads << ")\n"
+          "      --deterministic            report files in enumeration order\n"
+          "      --cache FILE               incremental scan cache\n"
+          "      --no-dedup                 scan files with identical content separately\n"
+          "      --archive-max-depth N      nested archive depth (" << d.archiveMaxDepth << ")\n"
+          "      --archive-max-ratio N      skip entries expanding more than N times (" << d.archiveMaxRatio << ")\n"
+          "      --archive-max-expanded SIZE\n"
+          "                                 expansion limit per outer archive (" << d.archiveMaxExpandedBytes << ")\n"
+          "      --all-archive-entries      inflate every archive entry, not only crypto-relevant ones\n"
+          "      --no-ast-regex-fallback    match source calls against AST rules only\n"
+          "      --regex-max-input SIZE     longest input handed to std::regex (" << d.regexMaxInput << ")\n"
+          "      --regex-budget-ms MS       move std::regex patterns slower than MS to the Pike VM, or to shorter\n"
+          "                                 inputs and then skip them; not a per-call limit, 0 = never (" << d.regexBudgetMs << ")\n"
+          "  -h, --help\n"
+          "\n"
+          "Exit status: 0 nothing at or above --fail-on, 1/2/3 highest severity found (low/med/high),\n"
+          "4 a path or the rules could not be read, 64 usage error, 128+N stopped by signal N.\n";
+}
+
+void printStats(const ScanStats& s, const Ruleset& rules, std::uint64_t detections, const std::uint64_t bySeverity[4]){
+    std::cerr << "rules: " << rules.sourcePath << " (" << rules.patterns.size() << " regex, "
+              << rules.oidBytePatterns.size() << " byte, " << rules.astRules->size() << " ast";
+    if(rules.astRules->dropped()) std::cerr << ", " << rules.astRules->dropped() << " ast dropped";
+    std::cerr << ")\n"
+              << "files scanned: " << s.filesScanned << " (" << s.bytesScanned << " bytes)\n"
+              << "cache: " << s.cacheHits << " hits, " << s.cacheMisses << " misses\n"
+              << "duplicates: " << s.duplicateFiles << " (" << s.duplicateBytes << " bytes)\n"
+              << "sources not parsed: " << s.astSkippedFiles << " (" << s.astSkippedBytes << " bytes)\n"
+              << "regex budget exceeded: " << s.regexBudgetExceeded
+              << ", patterns moved to the Pike VM: " << s.regexPatternsDemoted
+              << ", patterns skipped: " << s.regexPatternsSkipped << "\n";
+    for(const auto& kv: s.regexBudgetByPattern) std::cerr << "  " << kv.first << ": " << kv.second << "\n";
+    std::cerr << "detections: " << detections << " (high " << bySeverity[3] << ", med " << bySeverity[2]
+              << ", low " << bySeverity[1] << ")\n";
+}
+
+}
+
+int main(int argc, char** argv){
+    std::ios::sync_with_stdio(false);
+
+    ScanOptions opt;
+    DetectionWriter::Format format = DetectionWriter::Format::Ndjson;
+    std::string outPath, patternsPath;
+    int failOn = 1;
+    bool progress = false, stats = false;
+    std::vector<std::string> roots;
+
+    for(int i=1; i<argc; ++i){
+        std::string a = argv[i], val;
+        bool hasVal = false;
+        if(a.rfind("--", 0) == 0){
+            const auto eq = a.find('=');
+            if(eq != std::string::npos){ val = a.substr(eq + 1); a.erase(eq); hasVal = true; }
+        }
+        auto value = [&](std::string& v){
+            if(hasVal){ v = val; return true; }
+            if(i + 1 >= argc) return false;
+            v = argv[++i];
+            return true;
+        };
+        auto size = [&](auto& field){
+            std::string v;
+            std::uint64_t n;
+            if(!value(v) || !parseSize(v, n)) return false;
+            field = static_cast<std::remove_reference_t<decltype(field)>>(n);
+            return field == n;
+        };
+        auto bad = [&](){
+            std::cerr << "CryptoScannerCli: invalid or missing value for " << a << "\n";
+            return kUsage;
+        };
+
+        if(a == "-h" || a == "--help"){ usage(std::cout); return kClean; }
+        else if(a == "-f" || a == "--format"){
+            std::string v;
+            if(!value(v) || !DetectionWriter::parseFormat(v, format)) return bad();
+        }
+        else if(a == "-o" || a == "--output"){ if(!value(outPath)) return bad(); }
+        else if(a == "--patterns"){ if(!value(patternsPath)) return bad(); }
+        else if(a == "--fail-on"){
+            std::string v;
+            if(!value(v)) return bad();
+            if(v == "high") failOn = 3;
+            else if(v == "med") failOn = 2;
+            else if(v == "low") failOn = 1;
+            else if(v == "none") failOn = 4;
+            else return bad();
+        }
+        else if(a == "--progress") progress = true;
+        else if(a == "--stats") stats = true;
+        else if(a == "--no-recurse") opt.recurse = false;
+        else if(a == "--no-deep-jar") opt.deepJar = false;
+        else if(a == "--stream-threshold"){ if(!size(opt.streamThreshold) || !opt.streamThreshold) return bad(); }
+        else if(a == "--stream-window"){ if(!size(opt.streamWindow) || !opt.streamWindow) return bad(); }
+        else if(a == "-j" || a == "--threads"){ if(!size(opt.threads)) return bad(); }
+        else if(a == "--deterministic") opt.deterministicOrder = true;
+        else if(a == "--cache"){ if(!value(opt.cachePath)) return bad(); }
+        else if(a == "--no-dedup") opt.dedupContent = false;
+        else if(a == "--archive-max-depth"){ if(!size(opt.archiveMaxDepth)) return bad(); }
+        else if(a == "--archive-max-ratio"){ if(!size(opt.archiveMaxRatio)) return bad(); }
+        else if(a == "--archive-max-expanded"){ if(!size(opt.archiveMaxExpandedBytes)) return bad(); }
+        else if(a == "--all-archive-entries") opt.archiveSelectEntries = false;
+        else if(a == "--no-ast-regex-fallback") opt.astRegexFallback = false;
+        else if(a == "--regex-max-input"){ if(!size(opt.regexMaxInput) || !opt.regexMaxInput) return bad(); }
+        else if(a == "--regex-budget-ms"){ if(!size(opt.regexBudgetMs)) return bad(); }
+        else if(a == "--"){ for(++i; i<argc; ++i) roots.push_back(argv[i]); }
+        else if(a.size() > 1 && a[0] == '-'){
+            std::cerr << "CryptoScannerCli: unknown option " << a << "\n";
+            usage(std::cerr);
+            return kUsage;
+        }
+        else roots.push_back(a);
+    }
+    if(roots.empty()){ usage(std::cerr); return kUsage; }
+
+    // the ruleset is loaded on first use, by the scanner constructor below
+    if(!patternsPath.empty()) setenv("CRYPTO_PATTERNS", patternsPath.c_str(), 1);
+    CryptoScanner scanner;
+    const auto rules = Ruleset::current();
+    if(rules->patterns.empty() && rules->oidBytePatterns.empty()){
+        std::cerr << "CryptoScannerCli: no rules loaded from " << rules->sourcePath << "\n";
+        return kError;
+    }
+    scanner.setOptions(opt);
+
+    std::ofstream file;
+    if(!outPath.empty() && outPath != "-"){
+        file.open(outPath, std::ios::binary | std::ios::trunc);
+        if(!file){
+            std::cerr << "CryptoScannerCli: cannot write " << outPath << "\n";
+            return kError;
+        }
+    }
+    std::ostream& out = file.is_open() ? static_cast<std::ostream&>(file) : std::cout;
+    auto writer = DetectionWriter::create(format, out);
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Callbacks run under the scanner's callback lock, one at a time. Output is
+    // flushed after each file that produced detections so readers see them live.
+    std::uint64_t detections = 0, bySeverity[4] = {};
+    int worst = 0;
+    bool pending = false, complete = true;
+    auto lastReport = std::chrono::steady_clock::now();
+    ScanStats scanStats;
+
+    auto onDetect = [&](const Detection& d){
+        const int rank = severityRank(d.severity);
+        ++detections;
+        ++bySeverity[rank];
+        if(rank > worst) worst = rank;
+        writer->write(d);
+        pending = true;
+    };
+    auto onProgress = [&](const std::string&, std::uint64_t filesDone, std::uint64_t filesTotal,
+                          std::uint64_t bytesDone, std::uint64_t bytesTotal){
+        if(pending){
+            out.flush();
+            pending = false;
+        }
+        if(!progress) return;
+        const auto now = std::chrono::steady_clock::now();
+        if(now - lastReport < std::chrono::seconds(1) && filesDone != filesTotal) return;
+        lastReport = now;
+        std::cerr << "progress: " << filesDone << "/" << filesTotal << " files, "
+                  << (bytesDone >> 20) << "/" << (bytesTotal >> 20) << " MiB, "
+                  << detections << " detections\n";
+    };
+    auto isCancelled = [&](){ return gSignal.load() != 0 || !out; };
+
+    for(const auto& root: roots){
+        if(isCancelled()) break;
+        std::error_code ec;
+        if(!std::filesystem::exists(root, ec)){
+            std::cerr << "CryptoScannerCli: cannot access " << root << "\n";
+            complete = false;
+            continue;
+        }
+        scanner.scanPathLikeAntivirus(root, opt, onDetect, onProgress, isCancelled, &scanStats);
+    }
+    if(isCancelled()) complete = false;
+
+    writer->finish(complete);
+    out.flush();
+    if(stats) printStats(scanStats, *rules, detections, bySeverity);
+
+    if(const int sig = gSignal.load()) return 128 + sig;
+    if(!out){
+        std::cerr << "CryptoScannerCli: write error\n";
+        return kError;
+    }
+    if(!complete) return kError;
+    return worst >= failOn ? worst : kClean;
+}
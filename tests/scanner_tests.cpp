@@ -0,0 +1,127 @@
+#include "CryptoScanner.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what){
+    std::cout << (ok ? "ok   " : "FAIL ") << what << "\n";
+    if(!ok) ++failures;
+}
+
+// Copies of the sample directories, so the tests own their mtimes and paths.
+struct TempTree {
+    fs::path dir = fs::temp_directory_path() / ("cryptoscanner_tests." + std::to_string(getpid()));
+
+    TempTree(){
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        for(const char* name: { "test_jar", "test_source" })
+            fs::copy(fs::path(CRYPTOSCANNER_SOURCE_DIR) / name, dir / name, fs::copy_options::recursive);
+    }
+    ~TempTree(){ fs::remove_all(dir); }
+
+    std::string path(const std::string& name) const { return (dir / name).string(); }
+};
+
+ScanStats scan(const std::vector<std::string>& roots, const ScanOptions& opt, std::vector<Detection>* out = nullptr){
+    CryptoScanner scanner;
+    scanner.setOptions(opt);
+    ScanStats stats;
+    for(const auto& root: roots){
+        scanner.scanPathLikeAntivirus(root, opt,
+            [&](const Detection& d){ if(out) out->push_back(d); },
+            [](const std::string&, std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t){},
+            []{ return false; }, &stats);
+    }
+    return stats;
+}
+
+// Each root is scanned by its own call, as the CLI does; saving after one root
+// must not drop what the other root stored.
+void cacheSharedByTwoRoots(const TempTree& t){
+    ScanOptions opt;
+    opt.cachePath = t.path("cache");
+    const std::vector<std::string> roots{ t.path("test_jar"), t.path("test_source") };
+
+    const ScanStats first = scan(roots, opt);
+    check(first.cacheHits == 0 && first.cacheMisses > 0, "cache: first run of two roots scans every file");
+    const ScanStats second = scan(roots, opt);
+    check(second.cacheMisses == 0 && second.cacheHits == first.cacheMisses,
+          "cache: second run of two roots replays every file");
+
+    const ScanStats one = scan({ roots[1] }, opt);
+    check(one.cacheMisses == 0, "cache: single root still hits");
+    const ScanStats again = scan({ roots[0] }, opt);
+    check(again.cacheMisses == 0, "cache: other root kept after a single-root run");
+}
+
+}
+
+void noRecurseListsRootOnly(const TempTree& t){
+    const fs::path root = t.dir / "flat";
+    fs::create_directories(root / "sub");
+    fs::copy_file(t.dir / "test_source" / "weak_crypto.py", root / "weak_crypto.py");
+    fs::copy_file(t.dir / "test_source" / "weak_crypto.java", root / "sub" / "weak_crypto.java");
+
+    ScanOptions opt;
+    opt.recurse = false;
+    std::vector<Detection> found;
+    const ScanStats flat = scan({ root.string() }, opt, &found);
+    bool onlyTop = !found.empty();
+    for(const auto& d: found) onlyTop = onlyTop && d.filePath.find("/sub/") == std::string::npos;
+    check(flat.filesScanned == 1 && onlyTop, "walk: no recurse scans only the root's own files");
+
+    opt.recurse = true;
+    check(scan({ root.string() }, opt).filesScanned == 2, "walk: recurse scans subdirectories");
+}
+
+bool anyArchiveEntry(const std::vector<Detection>& found){
+    for(const auto& d: found) if(d.filePath.find("::") != std::string::npos) return true;
+    return false;
+}
+
+// Every archive extension goes through the same switch, not only .jar.
+void noDeepJarLeavesArchivesClosed(const TempTree& t){
+    const fs::path root = t.dir / "archives";
+    fs::create_directories(root);
+    for(const char* ext: { ".jar", ".zip", ".war", ".ear" })
+        fs::copy_file(t.dir / "test_jar" / "CryptoTest.jar", root / (std::string("CryptoTest") + ext));
+
+    ScanOptions opt;
+    opt.dedupContent = false;
+    std::vector<Detection> deep, flat;
+    scan({ root.string() }, opt, &deep);
+    check(anyArchiveEntry(deep), "archives: entries are scanned by default");
+    CryptoScanner scanner;
+    for(const char* ext: { ".jar", ".zip", ".war", ".ear" }){
+        const auto one = scanner.scanFileDetailed((root / (std::string("CryptoTest") + ext)).string());
+        check(anyArchiveEntry(one), std::string("archives: ") + ext + " is opened");
+    }
+
+    opt.deepJar = false;
+    const ScanStats stats = scan({ root.string() }, opt, &flat);
+    check(stats.filesScanned == 4 && !anyArchiveEntry(flat), "archives: no deep jar opens none of them");
+}
+
+int main(){
+    setenv("CRYPTO_PATTERNS", CRYPTOSCANNER_SOURCE_DIR "/patterns.json", 1);
+    TempTree tree;
+
+    cacheSharedByTwoRoots(tree);
+    noRecurseListsRootOnly(tree);
+    noDeepJarLeavesArchivesClosed(tree);
+
+    std::cout << (failures ? std::to_string(failures) + " failed" : std::string("all passed")) << "\n";
+    return failures ? 1 : 0;
+}
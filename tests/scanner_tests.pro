@@ -0,0 +1,15 @@
+# Scanner regression tests. Build and run out of tree:
+#   mkdir -p build-tests && cd build-tests && qmake ../tests/scanner_tests.pro && make && ./scanner_tests
+QT = core
+CONFIG += c++17 release console silent object_parallel_to_source no_batch
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = scanner_tests
+
+include(../CryptoScannerCore.pri)
+
+DEFINES += CRYPTOSCANNER_SOURCE_DIR=\\\"$$PWD/..\\\"
+
+SOURCES += \
+    scanner_tests.cpp
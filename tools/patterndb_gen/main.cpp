@@ -0,0 +1,68 @@
+// Build step: compiles patterns.json and writes it as C++ data for EmbeddedPatterns.h.
+// usage: patterndb_gen <patterns.json> <out.cpp>
+#include "PatternDb.h"
+#include "PatternLoader.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+// Octal escapes are always three digits, so a following digit never extends them.
+void appendLiteral(std::string& out, const std::string& db){
+    const std::size_t kLine = 64;
+    for(std::size_t i=0; i<db.size(); i+=kLine){
+        out += "    \"";
+        for(std::size_t j=i; j<db.size() && j<i+kLine; ++j){
+            const unsigned char c = (unsigned char)db[j];
+            if(c>=0x20 && c<0x7F && c!='"' && c!='\\' && c!='?'){
+                out += (char)c;
+            }else{
+                char esc[5];
+                std::snprintf(esc, sizeof esc, "\\%03o", c);
+                out += esc;
+            }
+        }
+        out += "\"\n";
+    }
+}
+
+}
+
+int main(int argc, char** argv){
+    if(argc != 3){
+        std::cerr << "usage: patterndb_gen <patterns.json> <out.cpp>\n";
+        return 2;
+    }
+    const auto LR = pattern_loader::compileJsonFile(argv[1]);
+    const std::string db = pattern_loader::serializeCompiled(LR);
+    if(db.empty()){
+        std::cerr << "patterndb_gen: " << argv[1] << ": " << LR.error << "\n";
+        return 1;
+    }
+    if(!LR.error.empty()) std::cerr << LR.error;
+
+    char hash[32];
+    std::snprintf(hash, sizeof hash, "0x%016llxULL", (unsigned long long)LR.rulesetHash);
+
+    std::string out;
+    out += "// Generated by tools/patterndb_gen from patterns.json; do not edit.\n";
+    out += "#include \"EmbeddedPatterns.h\"\n\n";
+    out += "namespace embedded_patterns {\n\n";
+    out += "extern const std::uint64_t kJsonHash = " + std::string(hash) + ";\n";
+    out += "extern const std::size_t   kDbSize = " + std::to_string(db.size()) + ";\n";
+    out += "alignas(8) extern const unsigned char kDb[" + std::to_string(db.size() + 1) + "] =\n";
+    appendLiteral(out, db);
+    out += ";\n\n} // namespace embedded_patterns\n";
+
+    std::ofstream ofs(argv[2], std::ios::binary | std::ios::trunc);
+    if(!ofs.write(out.data(), (std::streamsize)out.size()) || !ofs.flush()){
+        std::cerr << "patterndb_gen: cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cerr << "patterndb_gen: " << LR.regexPatterns.size() << " regex, " << LR.bytePatterns.size()
+              << " byte patterns, " << LR.astRules.size() << " AST rules, " << db.size() << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,28 @@
+QT = core
+CONFIG += c++17 release console silent object_parallel_to_source
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = patterndb_gen
+
+# the generator produces the embedded ruleset, so it cannot link one
+DEFINES += CRYPTOSCANNER_NO_EMBEDDED_PATTERNS
+DEFINES += QT_NO_DEBUG_OUTPUT QT_NO_WARNING_OUTPUT
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    main.cpp \
+    ../../PatternLoader.cpp \
+    ../../AstRuleIndex.cpp \
+    ../../PatternDb.cpp \
+    ../../MultiRegex.cpp \
+    ../../AhoCorasick.cpp \
+    ../../RegexPrefilter.cpp \
+    ../../ContentHash.cpp \
+    ../../MappedFile.cpp
+
+HEADERS += \
+    ../../PatternLoader.h \
+    ../../PatternDb.h \
+    ../../EmbeddedPatterns.h